@@ -0,0 +1,707 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/game.h"
+#include "core/replay.h"
+
+// Headless microbenchmarks for the core rules. Build and run with `make bench`.
+//
+// Every benchmark is timed over several samples after a warmup, and reports
+// the median and the fastest sample, which are far steadier between runs
+// than a single mean. `--csv` prints the results in a machine-readable form;
+// saving that and passing it back with `--baseline <file>` compares against
+// it and fails if anything got slower than `--threshold` percent.
+// `--replay <file>` adds a benchmark that re-simulates a recorded game.
+
+#define BOARD_COUNT 64
+#define PROBE_COUNT 4096
+#define ROUNDS 16
+#define SAMPLES 9
+#define MAX_RESULTS 32
+
+// Boards are restored between timed check_board passes, so a pass is short
+#define CLEAR_BATCH 256
+#define CLEAR_PASSES 64
+
+#define MOVE_OPERATIONS (1 << 20)
+#define QUEUE_OPERATIONS (1 << 20)
+#define GAME_PIECES 20000
+// A replay is simulated until at least this many steps are timed per sample
+#define REPLAY_STEPS (1 << 18)
+
+#define KERNEL_CHECKS (1 << 16)
+
+typedef struct Probe {
+  enum PieceType type;
+  uint8_t rotation;
+  int32_t x;
+  int32_t y;
+} Probe;
+
+typedef struct Result {
+  const char *name;
+  double median_ns;
+  double min_ns;
+} Result;
+
+typedef struct BenchOptions {
+  bool csv;
+  const char *baseline;
+  double threshold;
+  const char *filter;
+  const char *replay;
+} BenchOptions;
+
+static Result results[MAX_RESULTS];
+static int result_count;
+
+// Keeps results of the timed calls alive
+static volatile uint64_t sink;
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void random_board(GameState *state) {
+  game_init(state, rand());
+
+  // Leave the top rows empty so probes see a realistic mix of hits and misses
+  for (int y = 6; y < 16; y++)
+    state->board[y] = rand() % 3 ? (uint8_t)rand() : 0;
+
+  skyline_rebuild(&state->skyline, state->board);
+}
+
+// A board with `full_rows` complete rows scattered among partly filled ones.
+static void clearable_board(GameState *state, int full_rows) {
+  game_init(state, rand());
+
+  for (int y = 4; y < 16; y++)
+    state->board[y] = (uint8_t)(rand() % 255);
+
+  for (int placed = 0; placed < full_rows;) {
+    int y = 4 + rand() % 12;
+    if (state->board[y] != 0xFF) {
+      state->board[y] = 0xFF;
+      placed++;
+    }
+  }
+
+  // Random colors, but only where there are cells
+  for (int y = 0; y < 16; y++) {
+    uint8_t planes[3] = {0, 0, 0};
+    for (int x = 0; x < 8; x++) {
+      int color = rand() % 7;
+      for (int plane = 0; plane < 3; plane++) {
+        if (color >> plane & 1)
+          planes[plane] |= 0x80 >> x;
+      }
+    }
+    for (int plane = 0; plane < 3; plane++)
+      state->colors[plane][y] = planes[plane] & state->board[y];
+  }
+
+  skyline_rebuild(&state->skyline, state->board);
+}
+
+static void random_probe(Probe *probe) {
+  probe->type = (enum PieceType)(rand() % 7);
+  probe->rotation = rand() % ROTATION_DESCRIPTORS[probe->type].count;
+  probe->x = rand() % 11 - 2;
+  probe->y = rand() % 18 - 1;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static void report(const BenchOptions *options, const char *name, double samples[SAMPLES]) {
+  qsort(samples, SAMPLES, sizeof(double), compare_doubles);
+
+  Result *result = &results[result_count++];
+  result->name = name;
+  result->median_ns = samples[SAMPLES / 2];
+  result->min_ns = samples[0];
+
+  if (options->csv)
+    printf("%s,%.3f,%.3f,%.0f\n", name, result->median_ns, result->min_ns,
+           1e9 / result->median_ns);
+  else
+    printf("%-24s %10.2f ns/op %10.2f min %14.0f op/s\n", name, result->median_ns,
+           result->min_ns, 1e9 / result->median_ns);
+}
+
+static bool selected(const BenchOptions *options, const char *name) {
+  return !options->filter || strstr(name, options->filter);
+}
+
+// Every collision test against check_collision_repr, the plain shifting
+// version, probe by probe, including the five placements packed_collisions
+// tests at once.
+static void check_collision_kernels(const GameState *states, const Probe *probes) {
+  for (int b = 0; b < BOARD_COUNT; b++) {
+    for (int p = 0; p < PROBE_COUNT; p++) {
+      const Probe *probe = &probes[p];
+      const CollisionMask *mask = collision_mask(probe->type, probe->rotation, probe->x);
+      uint32_t packed = packed_collisions(states[b].board, mask, probe->y);
+
+      for (int k = 0; k < 5; k++) {
+        int32_t y = probe->y + k;
+        bool expected = check_collision_repr(
+            &states[b], ROTATION_DESCRIPTORS[probe->type].rotations[probe->rotation], probe->x, y);
+        bool table = check_collision(&states[b], probe->type, probe->rotation, probe->x, y);
+        bool window = check_collision_packed(&states[b], probe->type, probe->rotation, probe->x, y);
+        bool batched = packed >> k & 1;
+
+        if (table != expected || window != expected || batched != expected) {
+          fprintf(stderr,
+                  "Error: collision results differ on board %d for piece %d rotation %d at "
+                  "(%d, %d): repr %d, check_collision %d, check_collision_packed %d, "
+                  "packed_collisions %d\n",
+                  b, (int)probe->type, probe->rotation, probe->x, y, expected, table, window,
+                  batched);
+          exit(EXIT_FAILURE);
+        }
+      }
+    }
+  }
+}
+
+// Times a benchmark: a warmup sample, then SAMPLES more, each made of
+// `passes` calls to `run`, which does one pass over `context` and returns
+// how many operations it did. `reset`, if set, runs before every pass and
+// isn't timed, for benchmarks that change what they work on.
+static void run_bench(const BenchOptions *options, const char *name, int passes,
+                      void (*reset)(void *context), uint64_t (*run)(void *context),
+                      void *context) {
+  if (!selected(options, name))
+    return;
+
+  double samples[SAMPLES];
+  for (int sample = -1; sample < SAMPLES; sample++) {
+    uint64_t elapsed = 0;
+    uint64_t operations = 0;
+
+    for (int pass = 0; pass < passes; pass++) {
+      if (reset)
+        reset(context);
+
+      uint64_t start = now_ns();
+      operations += run(context);
+      elapsed += now_ns() - start;
+    }
+
+    if (sample >= 0)
+      samples[sample] = (double)elapsed / operations;
+  }
+  report(options, name, samples);
+}
+
+typedef struct CollisionBench {
+  const GameState *states;
+  const Probe *probes;
+} CollisionBench;
+
+static uint64_t run_collision_repr(void *context) {
+  const CollisionBench *bench = (const CollisionBench *)context;
+  uint64_t hits = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int b = 0; b < BOARD_COUNT; b++) {
+      for (int p = 0; p < PROBE_COUNT; p++) {
+        const Probe *probe = &bench->probes[p];
+        hits += check_collision_repr(
+            &bench->states[b], ROTATION_DESCRIPTORS[probe->type].rotations[probe->rotation],
+            probe->x, probe->y);
+      }
+    }
+  }
+
+  sink += hits;
+  return (uint64_t)ROUNDS * BOARD_COUNT * PROBE_COUNT;
+}
+
+static uint64_t run_collision(void *context) {
+  const CollisionBench *bench = (const CollisionBench *)context;
+  uint64_t hits = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int b = 0; b < BOARD_COUNT; b++) {
+      for (int p = 0; p < PROBE_COUNT; p++) {
+        const Probe *probe = &bench->probes[p];
+        hits += check_collision(&bench->states[b], probe->type, probe->rotation, probe->x,
+                                probe->y);
+      }
+    }
+  }
+
+  sink += hits;
+  return (uint64_t)ROUNDS * BOARD_COUNT * PROBE_COUNT;
+}
+
+static uint64_t run_collision_packed(void *context) {
+  const CollisionBench *bench = (const CollisionBench *)context;
+  uint64_t hits = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int b = 0; b < BOARD_COUNT; b++) {
+      for (int p = 0; p < PROBE_COUNT; p++) {
+        const Probe *probe = &bench->probes[p];
+        hits += check_collision_packed(&bench->states[b], probe->type, probe->rotation,
+                                       probe->x, probe->y);
+      }
+    }
+  }
+
+  sink += hits;
+  return (uint64_t)ROUNDS * BOARD_COUNT * PROBE_COUNT;
+}
+
+// Five placements per call, y..y+4, as a drop would test them
+static uint64_t run_packed_collisions(void *context) {
+  const CollisionBench *bench = (const CollisionBench *)context;
+  uint64_t hits = 0;
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int b = 0; b < BOARD_COUNT; b++) {
+      for (int p = 0; p < PROBE_COUNT; p++) {
+        const Probe *probe = &bench->probes[p];
+        hits += packed_collisions(bench->states[b].board,
+                                  collision_mask(probe->type, probe->rotation, probe->x),
+                                  probe->y);
+      }
+    }
+  }
+
+  sink += hits;
+  return (uint64_t)ROUNDS * BOARD_COUNT * PROBE_COUNT;
+}
+
+static void bench_collision(const BenchOptions *options, const GameState *states,
+                            const Probe *probes) {
+  CollisionBench bench = {states, probes};
+
+  run_bench(options, "check_collision_repr", 1, NULL, run_collision_repr, &bench);
+  run_bench(options, "check_collision", 1, NULL, run_collision, &bench);
+  run_bench(options, "check_collision_packed", 1, NULL, run_collision_packed, &bench);
+  run_bench(options, "packed_collisions", 1, NULL, run_packed_collisions, &bench);
+}
+
+static uint64_t run_rotate(void *context) {
+  GameState *states = (GameState *)context;
+  uint64_t rotated = 0;
+
+  for (int i = 0; i < MOVE_OPERATIONS; i++)
+    rotated += rotate_piece(&states[i & (BOARD_COUNT - 1)]);
+
+  sink += rotated;
+  return MOVE_OPERATIONS;
+}
+
+static void bench_rotate(const BenchOptions *options, const GameState *boards) {
+  if (!selected(options, "rotate_piece"))
+    return;
+
+  GameState *states = game_alloc(BOARD_COUNT);
+  memcpy(states, boards, sizeof(GameState) * BOARD_COUNT);
+
+  run_bench(options, "rotate_piece", 1, NULL, run_rotate, states);
+
+  game_free(states);
+}
+
+static uint64_t run_move(void *context) {
+  // Left, down, right, up: the piece wanders but never leaves the board
+  static const int32_t DELTAS[4][2] = {{-1, 0}, {0, 1}, {1, 0}, {0, -1}};
+
+  GameState *states = (GameState *)context;
+  uint64_t moved = 0;
+
+  for (int i = 0; i < MOVE_OPERATIONS; i++) {
+    const int32_t *delta = DELTAS[(i / BOARD_COUNT) & 3];
+    moved += try_move(&states[i & (BOARD_COUNT - 1)], delta[0], delta[1]);
+  }
+
+  sink += moved;
+  return MOVE_OPERATIONS;
+}
+
+static void bench_move(const BenchOptions *options, const GameState *boards) {
+  if (!selected(options, "try_move"))
+    return;
+
+  GameState *states = game_alloc(BOARD_COUNT);
+  memcpy(states, boards, sizeof(GameState) * BOARD_COUNT);
+
+  run_bench(options, "try_move", 1, NULL, run_move, states);
+
+  game_free(states);
+}
+
+// The vector board kernels (built with `make bench SIMD=1`) against the
+// scalar ones they replace, on random boards with up to 16 full rows.
+static void check_board_kernels() {
+  for (int i = 0; i < KERNEL_CHECKS; i++) {
+    uint8_t board[16];
+    for (int y = 0; y < 16; y++)
+      board[y] = rand() % 3 ? (uint8_t)rand() : 0xFF;
+
+    uint8_t vector_board[16];
+    uint8_t scalar_board[16];
+    memcpy(vector_board, board, 16);
+    memcpy(scalar_board, board, 16);
+    LineClear vector_clear = clear_lines(vector_board);
+    LineClear scalar_clear = clear_lines_scalar(scalar_board);
+    if (vector_clear.rows != scalar_clear.rows || vector_clear.count != scalar_clear.count ||
+        memcmp(vector_board, scalar_board, 16) != 0) {
+      fprintf(stderr, "Error: clear_lines and clear_lines_scalar differ\n");
+      exit(EXIT_FAILURE);
+    }
+
+    uint16_t cleared = (uint16_t)rand();
+    uint8_t vector_sets[3][16];
+    uint8_t scalar_sets[3][16];
+    for (int set = 0; set < 3; set++) {
+      for (int y = 0; y < 16; y++)
+        vector_sets[set][y] = scalar_sets[set][y] = (uint8_t)rand();
+    }
+
+    compact_rows(vector_sets[0], cleared);
+    compact_rows_scalar(scalar_sets[0], cleared);
+    if (memcmp(vector_sets[0], scalar_sets[0], 16) != 0) {
+      fprintf(stderr, "Error: compact_rows and compact_rows_scalar differ\n");
+      exit(EXIT_FAILURE);
+    }
+
+    compact_row_sets(vector_sets, 3, cleared);
+    compact_row_sets_scalar(scalar_sets, 3, cleared);
+    if (memcmp(vector_sets, scalar_sets, sizeof(vector_sets)) != 0) {
+      fprintf(stderr, "Error: compact_row_sets and compact_row_sets_scalar differ\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+}
+
+// Boards that a benchmark changes, restored from `templates` before every
+// pass so a pass always starts from the same ones.
+typedef struct BatchBench {
+  GameState *states;
+  GameState *templates;
+  int holes[CLEAR_BATCH];
+} BatchBench;
+
+static void restore_batch(void *context) {
+  BatchBench *bench = (BatchBench *)context;
+  memcpy(bench->states, bench->templates, sizeof(GameState) * CLEAR_BATCH);
+}
+
+static uint64_t run_check_board(void *context) {
+  BatchBench *bench = (BatchBench *)context;
+
+  for (int i = 0; i < CLEAR_BATCH; i++)
+    check_board(&bench->states[i]);
+
+  sink += bench->states[CLEAR_BATCH - 1].score;
+  return CLEAR_BATCH;
+}
+
+static void bench_check_board(const BenchOptions *options) {
+  static const char *NAMES[5] = {
+      "check_board_0_rows", "check_board_1_row",  "check_board_2_rows",
+      "check_board_3_rows", "check_board_4_rows",
+  };
+
+  BatchBench bench;
+  bench.templates = game_alloc(CLEAR_BATCH);
+  bench.states = game_alloc(CLEAR_BATCH);
+
+  for (int full_rows = 0; full_rows <= 4; full_rows++) {
+    if (!selected(options, NAMES[full_rows]))
+      continue;
+
+    for (int i = 0; i < CLEAR_BATCH; i++)
+      clearable_board(&bench.templates[i], full_rows);
+
+    run_bench(options, NAMES[full_rows], CLEAR_PASSES, restore_batch, run_check_board, &bench);
+  }
+
+  game_free(bench.templates);
+  game_free(bench.states);
+}
+
+static uint64_t run_insert_garbage(void *context) {
+  BatchBench *bench = (BatchBench *)context;
+
+  for (int i = 0; i < CLEAR_BATCH; i++)
+    insert_garbage(&bench->states[i], 1, bench->holes[i]);
+
+  sink += bench->states[CLEAR_BATCH - 1].board[15];
+  return CLEAR_BATCH;
+}
+
+// One garbage row at a time into partly filled boards, restored between
+// passes like check_board's.
+static void bench_insert_garbage(const BenchOptions *options) {
+  if (!selected(options, "insert_garbage"))
+    return;
+
+  BatchBench bench;
+  bench.templates = game_alloc(CLEAR_BATCH);
+  bench.states = game_alloc(CLEAR_BATCH);
+
+  for (int i = 0; i < CLEAR_BATCH; i++) {
+    random_board(&bench.templates[i]);
+    bench.holes[i] = rand() % 8;
+  }
+
+  run_bench(options, "insert_garbage", CLEAR_PASSES, restore_batch, run_insert_garbage, &bench);
+
+  game_free(bench.templates);
+  game_free(bench.states);
+}
+
+static uint64_t run_pop_queue(void *context) {
+  GameState *state = (GameState *)context;
+
+  for (int i = 0; i < QUEUE_OPERATIONS; i++)
+    pop_queue(state);
+
+  sink += state->falling_piece.type;
+  return QUEUE_OPERATIONS;
+}
+
+static void bench_pop_queue(const BenchOptions *options) {
+  if (!selected(options, "pop_queue"))
+    return;
+
+  GameState *state = game_alloc(1);
+  game_init(state, 1);
+
+  run_bench(options, "pop_queue", 1, NULL, run_pop_queue, state);
+
+  game_free(state);
+}
+
+// Whole games through step(): each piece gets a random number of rotations
+// and a random sideways shift, then a hard drop. Reported per locked piece.
+static uint64_t run_full_game(void *context) {
+  GameState *state = (GameState *)context;
+  uint64_t pieces = 0;
+  uint64_t seed = 1;
+  game_init(state, seed++);
+
+  while (pieces + state->pieces < GAME_PIECES) {
+    if (state->game_over) {
+      pieces += state->pieces;
+      game_init(state, seed++);
+    }
+
+    for (int rotations = rand() % 4; rotations > 0; rotations--)
+      step(state, INPUT_ROTATE);
+
+    int shift = rand() % 8 - 4;
+    for (; shift < 0; shift++)
+      step(state, INPUT_LEFT);
+    for (; shift > 0; shift--)
+      step(state, INPUT_RIGHT);
+
+    step(state, INPUT_HARD_DROP);
+  }
+  pieces += state->pieces;
+
+  sink += state->score;
+  return pieces;
+}
+
+static void bench_full_game(const BenchOptions *options) {
+  if (!selected(options, "full_game"))
+    return;
+
+  GameState *state = game_alloc(1);
+
+  run_bench(options, "full_game", 1, NULL, run_full_game, state);
+
+  game_free(state);
+}
+
+typedef struct ReplayBench {
+  const uint8_t *data;
+  size_t size;
+  GameState *state;
+  uint64_t runs;
+  uint64_t steps;
+} ReplayBench;
+
+static uint64_t run_replay(void *context) {
+  ReplayBench *bench = (ReplayBench *)context;
+  ReplayTrailer claimed;
+
+  for (uint64_t run = 0; run < bench->runs; run++)
+    replay_simulate(bench->data, bench->size, bench->state, &claimed);
+
+  sink += bench->state->score;
+  return bench->runs * bench->steps;
+}
+
+// A recorded game through replay_simulate, over and over. Reported per
+// recorded step.
+static bool bench_replay(const BenchOptions *options) {
+  if (!options->replay || !selected(options, "replay"))
+    return true;
+
+  FILE *file = fopen(options->replay, "rb");
+  if (!file) {
+    fprintf(stderr, "Error: Couldn't open replay %s\n", options->replay);
+    return false;
+  }
+
+  fseek(file, 0, SEEK_END);
+  size_t size = (size_t)ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = (uint8_t *)malloc(size);
+  bool read = data && fread(data, 1, size, file) == size;
+  fclose(file);
+
+  ReplayReader reader;
+  uint64_t steps = 0;
+  uint64_t tick;
+  enum GameInput input;
+  if (read && replay_reader_init(&reader, data, size))
+    while (replay_next(&reader, &tick, &input) == REPLAY_RECORD_EVENT)
+      steps++;
+
+  if (steps == 0) {
+    fprintf(stderr, "Error: %s isn't a replay with any steps\n", options->replay);
+    free(data);
+    return false;
+  }
+
+  ReplayBench bench;
+  bench.data = data;
+  bench.size = size;
+  bench.state = game_alloc(1);
+  bench.steps = steps;
+  bench.runs = (REPLAY_STEPS + steps - 1) / steps;
+
+  run_bench(options, "replay", 1, NULL, run_replay, &bench);
+
+  game_free(bench.state);
+  free(data);
+  return true;
+}
+
+// Compares against a file written by --csv. Returns false if anything is
+// slower than the threshold allows.
+static bool compare_baseline(const BenchOptions *options) {
+  FILE *file = fopen(options->baseline, "r");
+  if (!file) {
+    fprintf(stderr, "Error: Couldn't open baseline %s\n", options->baseline);
+    return false;
+  }
+
+  bool passed = true;
+  char line[256];
+
+  // The comparison goes to stderr so --csv output stays clean
+  fflush(stdout);
+  fprintf(stderr, "\n%-24s %10s %10s %8s\n", "benchmark", "baseline", "current", "change");
+  while (fgets(line, sizeof(line), file)) {
+    char name[64];
+    double median_ns;
+
+    if (sscanf(line, "%63[^,],%lf", name, &median_ns) != 2)
+      continue;
+
+    for (int i = 0; i < result_count; i++) {
+      if (strcmp(results[i].name, name) != 0)
+        continue;
+
+      double change = (results[i].median_ns / median_ns - 1) * 100;
+      bool regressed = change > options->threshold;
+
+      fprintf(stderr, "%-24s %10.2f %10.2f %+7.1f%%%s\n", name, median_ns,
+              results[i].median_ns, change, regressed ? "  REGRESSED" : "");
+      passed &= !regressed;
+    }
+  }
+
+  fclose(file);
+  return passed;
+}
+
+static bool parse_bench_options(BenchOptions *options, int argc, char *argv[]) {
+  options->csv = false;
+  options->baseline = NULL;
+  options->threshold = 5;
+  options->filter = NULL;
+  options->replay = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      options->csv = true;
+    } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      options->baseline = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+      options->threshold = strtod(argv[++i], NULL);
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      options->filter = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      options->replay = argv[++i];
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--csv] [--baseline <csv>] [--threshold <percent>] "
+              "[--filter <substring>] [--replay <file>]\n",
+              argv[0]);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions options;
+  if (!parse_bench_options(&options, argc, argv))
+    return EXIT_FAILURE;
+
+  srand(1);
+
+  GameState *states = game_alloc(BOARD_COUNT);
+  Probe *probes = (Probe *)malloc(sizeof(Probe) * PROBE_COUNT);
+
+  for (int i = 0; i < BOARD_COUNT; i++)
+    random_board(&states[i]);
+  for (int i = 0; i < PROBE_COUNT; i++)
+    random_probe(&probes[i]);
+
+  if (options.csv)
+    printf("name,median_ns_per_op,min_ns_per_op,ops_per_sec\n");
+
+  check_collision_kernels(states, probes);
+  check_board_kernels();
+  bench_collision(&options, states, probes);
+  bench_rotate(&options, states);
+  bench_move(&options, states);
+  bench_check_board(&options);
+  bench_insert_garbage(&options);
+  bench_pop_queue(&options);
+  bench_full_game(&options);
+  bool replayed = bench_replay(&options);
+
+  free(probes);
+  game_free(states);
+
+  if (!replayed)
+    return EXIT_FAILURE;
+
+  if (options.baseline && !compare_baseline(&options))
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
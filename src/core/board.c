@@ -0,0 +1,133 @@
+#include "board.h"
+
+#if BOARD_SIMD
+#include <immintrin.h>
+#endif
+
+LineClear clear_lines_scalar(uint8_t board[16]) {
+  LineClear clear = {0, 0};
+
+  for (int y = 0; y < 16; y++) {
+    if (board[y] == 0xFF) {
+      clear.rows |= 1 << y;
+      clear.count++;
+    }
+  }
+
+  if (clear.rows)
+    compact_rows_scalar(board, clear.rows);
+
+  return clear;
+}
+
+void compact_rows_scalar(uint8_t rows[16], uint16_t cleared) {
+  int dest_y = 15;
+
+  for (int y = 15; y >= 0; y--) {
+    if (!(cleared & (1 << y)))
+      rows[dest_y--] = rows[y];
+  }
+
+  while (dest_y >= 0)
+    rows[dest_y--] = 0;
+}
+
+void compact_row_sets_scalar(uint8_t sets[][16], int count, uint16_t cleared) {
+  int dest_y = 15;
+
+  // Cleared rows are copied too, but don't move the destination up, so the
+  // next row that is kept lands on top of them. No branch on which rows
+  // cleared.
+  for (int y = 15; y >= 0; y--) {
+    for (int set = 0; set < count; set++)
+      sets[set][dest_y] = sets[set][y];
+    dest_y -= !(cleared & (1 << y));
+  }
+
+  for (; dest_y >= 0; dest_y--) {
+    for (int set = 0; set < count; set++)
+      sets[set][dest_y] = 0;
+  }
+}
+
+uint8_t push_rows(uint8_t rows[16], int count, uint8_t fill) {
+  uint8_t lost = 0;
+  for (int y = 0; y < count; y++)
+    lost |= rows[y];
+
+  memmove(rows, rows + count, 16 - count);
+  memset(rows + 16 - count, fill, count);
+
+  return lost;
+}
+
+#if BOARD_SIMD
+
+// Builds the pshufb control that packs the surviving rows against the bottom
+// of the board. The indices of the survivors are gathered as nibbles with
+// pext, shifted past the cleared rows and widened to bytes; the lanes that
+// end up empty get 0x80 so the shuffle zeroes them.
+static __m128i compaction_shuffle(uint16_t cleared) {
+  uint32_t count = __builtin_popcount(cleared);
+  uint64_t keep = _pdep_u64((uint16_t)~cleared, 0x1111111111111111ull) * 0xF;
+  uint64_t indices = _pext_u64(0xFEDCBA9876543210ull, keep);
+
+  indices = count == 16 ? 0 : indices << (count * 4);
+
+  __m128i nibbles = _mm_cvtsi64_si128((long long)indices);
+  __m128i low = _mm_and_si128(nibbles, _mm_set1_epi8(0x0F));
+  __m128i high = _mm_and_si128(_mm_srli_epi16(nibbles, 4), _mm_set1_epi8(0x0F));
+  __m128i control = _mm_unpacklo_epi8(low, high);
+
+  __m128i lanes = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i empty = _mm_cmplt_epi8(lanes, _mm_set1_epi8((char)count));
+
+  return _mm_or_si128(control, _mm_and_si128(empty, _mm_set1_epi8((char)0x80)));
+}
+
+LineClear clear_lines(uint8_t board[16]) {
+  __m128i rows = _mm_loadu_si128((const __m128i *)board);
+  __m128i full = _mm_cmpeq_epi8(rows, _mm_set1_epi8((char)0xFF));
+  uint16_t cleared = (uint16_t)_mm_movemask_epi8(full);
+
+  LineClear clear = {cleared, (uint8_t)__builtin_popcount(cleared)};
+
+  if (cleared) {
+    rows = _mm_shuffle_epi8(rows, compaction_shuffle(cleared));
+    _mm_storeu_si128((__m128i *)board, rows);
+  }
+
+  return clear;
+}
+
+void compact_rows(uint8_t rows[16], uint16_t cleared) {
+  __m128i vector = _mm_loadu_si128((const __m128i *)rows);
+  vector = _mm_shuffle_epi8(vector, compaction_shuffle(cleared));
+  _mm_storeu_si128((__m128i *)rows, vector);
+}
+
+void compact_row_sets(uint8_t sets[][16], int count, uint16_t cleared) {
+  __m128i shuffle = compaction_shuffle(cleared);
+
+  for (int set = 0; set < count; set++) {
+    __m128i vector = _mm_loadu_si128((const __m128i *)sets[set]);
+    vector = _mm_shuffle_epi8(vector, shuffle);
+    _mm_storeu_si128((__m128i *)sets[set], vector);
+  }
+}
+
+#else
+
+LineClear clear_lines(uint8_t board[16]) {
+  return clear_lines_scalar(board);
+}
+
+void compact_rows(uint8_t rows[16], uint16_t cleared) {
+  compact_rows_scalar(rows, cleared);
+}
+
+void compact_row_sets(uint8_t sets[][16], int count, uint16_t cleared) {
+  compact_row_sets_scalar(sets, count, cleared);
+}
+
+#endif
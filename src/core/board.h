@@ -0,0 +1,93 @@
+#ifndef BRICKGAME_CORE_BOARD_H
+#define BRICKGAME_CORE_BOARD_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Kernels that work on a whole 16-row board at once. A board is one byte per
+// row, row 0 at the top, so all 16 rows fit in a single 128-bit register.
+//
+// With SSSE3 and BMI2 available (e.g. -march=haswell or newer) the vector
+// versions are used; otherwise the scalar ones are, and both must produce the
+// exact same rows.
+
+#if defined(__SSSE3__) && defined(__BMI2__) && !defined(BOARD_NO_SIMD)
+#define BOARD_SIMD 1
+#else
+#define BOARD_SIMD 0
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+typedef struct LineClear {
+  uint16_t rows; // bit y is set for every row that was cleared
+  uint8_t count;
+} LineClear;
+
+// Removes every full row, letting the rows above fall into the gaps, and
+// reports which rows were removed.
+LineClear clear_lines(uint8_t board[16]);
+
+// Applies the compaction of a clear that removed `cleared` to a different set
+// of 16 rows, e.g. one that stores per-cell data alongside the bitboard.
+void compact_rows(uint8_t rows[16], uint16_t cleared);
+
+// Moves every row up by `count`, 1 to 16, and fills the rows that opens up at
+// the bottom with `fill`. Returns the rows pushed off the top, OR-ed
+// together, so anything but 0 means cells were lost. The board is only 16
+// bytes, so this is one short move whatever the count.
+uint8_t push_rows(uint8_t rows[16], int count, uint8_t fill);
+
+// compact_rows for several sets of rows at once, e.g. the color planes,
+// working out where each row goes only once.
+void compact_row_sets(uint8_t sets[][16], int count, uint16_t cleared);
+
+// Rows y..y+7 packed into one word, row y in the low byte. Rows above or
+// below the board read as solid, so a piece packed the same way collides
+// with the floor, the ceiling and the stack through a single AND. Assumes a
+// little-endian target, like every platform the game ships on.
+static inline uint64_t board_window(const uint8_t board[16], int32_t y) {
+  if (y <= -8 || y >= 16)
+    return ~0ull;
+
+  uint64_t words[4] = {~0ull, 0, 0, ~0ull};
+  memcpy(&words[1], board, 16);
+
+  int index = (y + 8) >> 3;
+  int shift = (y & 7) * 8;
+
+  if (!shift)
+    return words[index];
+
+  return (words[index] >> shift) | (words[index + 1] << (64 - shift));
+}
+
+// Transposes the board into one 16-bit mask per column, bit y set if the
+// cell at row y is filled. Column 0 is the leftmost one.
+static inline void board_columns(const uint8_t board[16], uint16_t columns[8]) {
+#ifdef __SSE2__
+  // movemask picks the top bit of every row; shifting left by x moves the
+  // bit of column x there
+  __m128i rows = _mm_loadu_si128((const __m128i *)board);
+
+  for (int x = 0; x < 8; x++)
+    columns[x] = (uint16_t)_mm_movemask_epi8(_mm_slli_epi64(rows, x));
+#else
+  for (int x = 0; x < 8; x++) {
+    columns[x] = 0;
+
+    for (int y = 0; y < 16; y++) {
+      if (board[y] & (0x80 >> x))
+        columns[x] |= 1 << y;
+    }
+  }
+#endif
+}
+
+LineClear clear_lines_scalar(uint8_t board[16]);
+void compact_rows_scalar(uint8_t rows[16], uint16_t cleared);
+void compact_row_sets_scalar(uint8_t sets[][16], int count, uint16_t cleared);
+
+#endif
@@ -0,0 +1,329 @@
+#include "game.h"
+
+#include "board.h"
+#include "trace.h"
+
+#include <assert.h>
+#include <memory.h>
+#include <stdlib.h>
+
+// Build with -DSKYLINE_DEBUG to check the incremental skyline against a full
+// rescan of the board after every change.
+#ifdef SKYLINE_DEBUG
+#define CHECK_SKYLINE(state) assert(skyline_matches(&(state)->skyline, (state)->board))
+#else
+#define CHECK_SKYLINE(state)
+#endif
+
+static const uint32_t FALLING_PIECE_INTERVAL = 800;
+
+static uint8_t safe_shl(uint8_t value, int sh) {
+  if (sh < 0)
+    return value >> -sh;
+  else if (sh > 0)
+    return value << sh;
+  return value;
+}
+
+static uint8_t safe_shr(uint8_t value, int sh) {
+  if (sh < 0)
+    return value << -sh;
+  else if (sh > 0)
+    return value >> sh;
+  return value;
+}
+
+bool check_collision(const GameState *state, enum PieceType type, uint8_t rotation,
+                     int32_t x, int32_t y) {
+  return mask_collides(state->board, collision_mask(type, rotation, x), y);
+}
+
+bool check_collision_packed(const GameState *state, enum PieceType type,
+                            uint8_t rotation, int32_t x, int32_t y) {
+  return packed_collides(state->board, collision_mask(type, rotation, x), y);
+}
+
+bool check_collision_repr(const GameState *state, const PieceRepresentation repr,
+                          int32_t x, int32_t y) {
+  for (int i = 0; i < 4; i++) {
+    if (!repr[i])
+      continue;
+
+    int real_y = y + i;
+
+    if (real_y < 0 || real_y >= 16 || safe_shl(safe_shr(repr[i], x), x) != repr[i] ||
+        (state->board[real_y] & safe_shr(repr[i], x)))
+      return true;
+  }
+
+  return false;
+}
+
+Piece new_piece(enum PieceType type) {
+  Piece piece = {
+    .type = type,
+    .rotation = 0,
+    .repr_cache = { 0, 0, 0, 0 },
+  };
+
+  memcpy(&piece.repr_cache, &ROTATION_DESCRIPTORS[piece.type].rotations[0], 4);
+
+  return piece;
+}
+
+bool rotate_piece(GameState *state) {
+  Piece *piece = &state->falling_piece;
+  const PieceRotationDescriptor *rotation = &ROTATION_DESCRIPTORS[piece->type];
+
+  if (!check_collision(state, piece->type, (piece->rotation + 1) % rotation->count,
+                       state->falling_piece_x, state->falling_piece_y)) {
+    piece->rotation = (piece->rotation + 1) % rotation->count;
+    memcpy(&piece->repr_cache, &rotation->rotations[piece->rotation], 4);
+    return true;
+  }
+
+  return false;
+}
+
+bool try_move(GameState *state, int32_t delta_x, int32_t delta_y) {
+  const Piece *piece = &state->falling_piece;
+
+  if (!check_collision(state, piece->type, piece->rotation,
+                       state->falling_piece_x + delta_x,
+                       state->falling_piece_y + delta_y)) {
+    state->falling_piece_x += delta_x;
+    state->falling_piece_y += delta_y;
+    return true;
+  }
+
+  return false;
+}
+
+void pop_queue(GameState *state) {
+  state->falling_piece = state->piece_queue[0];
+  state->piece_queue[0] = state->piece_queue[1];
+  state->piece_queue[1] = state->piece_queue[2];
+  state->piece_queue[2] = new_piece(bag_next(&state->bag, &state->rng));
+
+  state->falling_piece_x = 1;
+  state->falling_piece_y = 0;
+
+  if (check_collision(state, state->falling_piece.type, state->falling_piece.rotation,
+                      state->falling_piece_x, state->falling_piece_y))
+    state->game_over = true;
+}
+
+static uint64_t chain_bonus(int chain) {
+  if (chain == 3)
+    return 25;
+  else if (chain == 4)
+    return 50;
+  else if (chain > 4)
+    return 50 + chain * 10;
+  return 0;
+}
+
+void check_board(GameState *state) {
+  TRACE_SCOPE("check_board");
+
+  LineClear clear = clear_lines(state->board);
+
+  if (!clear.count)
+    return;
+
+  skyline_clear_rows(&state->skyline, clear.rows);
+  CHECK_SKYLINE(state);
+  state->board_revision++;
+
+  // Same compaction as the bitboard, for every color plane
+  compact_row_sets(state->colors, 3, clear.rows);
+
+  // Every run of adjacent rows scores as one chain
+  uint32_t rows = clear.rows;
+  while (rows) {
+    int start = __builtin_ctz(rows);
+    int chain = __builtin_ctz(~(rows >> start));
+
+    state->score += 10 * chain + chain_bonus(chain);
+    rows &= ~(((1u << chain) - 1) << start);
+  }
+
+  state->lines += clear.count;
+}
+
+int32_t drop_distance(const GameState *state) {
+  const Piece *piece = &state->falling_piece;
+  const CollisionMask *mask =
+      collision_mask(piece->type, piece->rotation, state->falling_piece_x);
+
+  const uint16_t *columns = state->skyline.columns;
+
+  // Only the lowest cell of each column of the piece can be the first to hit
+  // something, so the distance is the smallest gap below one of those
+  int32_t distance = 16;
+  for (int c = 0; c < 4; c++) {
+    if (mask->profile[c] < 0)
+      continue;
+
+    int32_t row = state->falling_piece_y + mask->profile[c];
+    uint32_t below = (uint32_t)columns[state->falling_piece_x + c] >> (row + 1);
+    int32_t gap = below ? __builtin_ctz(below) : 15 - row;
+
+    if (gap < distance)
+      distance = gap;
+  }
+
+  return distance;
+}
+
+static void update_ghost(GameState *state) {
+  state->ghost_y = state->falling_piece_y + drop_distance(state);
+}
+
+void insert_garbage(GameState *state, int32_t rows, int32_t hole_x) {
+  if (state->paused || state->game_over || rows <= 0)
+    return;
+  if (rows > 16)
+    rows = 16;
+
+  uint8_t fill = (uint8_t)~(0b10000000 >> (hole_x & 7));
+
+  uint8_t lost = push_rows(state->board, rows, fill);
+  for (int plane = 0; plane < 3; plane++)
+    push_rows(state->colors[plane], rows, GARBAGE >> plane & 1 ? fill : 0);
+
+  skyline_push_rows(&state->skyline, rows, fill);
+  CHECK_SKYLINE(state);
+  state->board_revision++;
+
+  // Lift the piece out of the garbage, as far as the stack rose at most
+  const Piece *piece = &state->falling_piece;
+  int32_t lifted = 0;
+  while (lifted < rows && check_collision(state, piece->type, piece->rotation,
+                                          state->falling_piece_x, state->falling_piece_y)) {
+    state->falling_piece_y--;
+    lifted++;
+  }
+
+  if (lost || check_collision(state, piece->type, piece->rotation, state->falling_piece_x,
+                              state->falling_piece_y))
+    state->game_over = true;
+  else
+    update_ghost(state);
+}
+
+static void lock_piece(GameState *state) {
+  const Piece *piece = &state->falling_piece;
+  int32_t piece_x = state->falling_piece_x;
+  int32_t piece_y = state->falling_piece_y;
+
+  const CollisionMask *mask = collision_mask(piece->type, piece->rotation, piece_x);
+
+  // Solidify falling piece, and paint its cells in the planes of its color
+  for (int i = mask->top; i <= mask->bottom; i++) {
+    state->board[piece_y + i] |= mask->rows[i];
+
+    for (int plane = 0; plane < 3; plane++) {
+      if (piece->type >> plane & 1)
+        state->colors[plane][piece_y + i] |= mask->rows[i];
+    }
+  }
+
+  skyline_add_piece(&state->skyline, mask, piece_y);
+  CHECK_SKYLINE(state);
+  state->board_revision++;
+
+  state->pieces++;
+
+  // Clear rows before spawning, so the spawn check sees the board the new
+  // piece actually enters
+  check_board(state);
+
+  // Generate new falling piece
+  pop_queue(state);
+}
+
+static bool apply_gravity(GameState *state) {
+  if (!try_move(state, 0, 1))
+    lock_piece(state);
+
+  return true;
+}
+
+void game_init(GameState *state, uint64_t seed) {
+  memset(state, 0, sizeof(GameState));
+
+  skyline_rebuild(&state->skyline, state->board);
+
+  rng_seed(&state->rng, seed);
+  bag_init(&state->bag);
+
+  state->piece_queue[0] = new_piece(bag_next(&state->bag, &state->rng));
+  state->piece_queue[1] = new_piece(bag_next(&state->bag, &state->rng));
+  state->piece_queue[2] = new_piece(bag_next(&state->bag, &state->rng));
+  pop_queue(state);
+  update_ghost(state);
+}
+
+GameState *game_alloc(size_t count) {
+  void *states = NULL;
+
+  if (posix_memalign(&states, GAME_CACHE_LINE_SIZE, sizeof(GameState) * count) != 0)
+    return NULL;
+
+  return (GameState *)states;
+}
+
+void game_free(GameState *states) {
+  free(states);
+}
+
+bool step(GameState *state, enum GameInput input) {
+  if (input == INPUT_PAUSE) {
+    state->paused = !state->paused;
+    return true;
+  }
+
+  if (state->paused || state->game_over)
+    return false;
+
+  bool changed = false;
+
+  switch (input) {
+  case INPUT_ROTATE:
+    changed = rotate_piece(state);
+    break;
+  case INPUT_LEFT:
+    changed = try_move(state, -1, 0);
+    break;
+  case INPUT_RIGHT:
+    changed = try_move(state, 1, 0);
+    break;
+  case INPUT_DOWN:
+    changed = try_move(state, 0, 1);
+    break;
+  case INPUT_HARD_DROP:
+    state->falling_piece_y += drop_distance(state);
+    changed = apply_gravity(state);
+    break;
+  case INPUT_GRAVITY:
+    changed = apply_gravity(state);
+    break;
+  default:
+    break;
+  }
+
+  if (changed)
+    update_ghost(state);
+
+  return changed;
+}
+
+uint32_t gravity_interval(const GameState *state) {
+  uint64_t speedup = state->score / 10;
+
+  if (speedup >= FALLING_PIECE_INTERVAL)
+    return 1;
+
+  return FALLING_PIECE_INTERVAL - (uint32_t)speedup;
+}
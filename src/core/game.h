@@ -0,0 +1,117 @@
+#ifndef BRICKGAME_CORE_GAME_H
+#define BRICKGAME_CORE_GAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pieces.h"
+#include "random.h"
+#include "skyline.h"
+
+// Game rules without any SDL dependency. Everything that used to live in
+// globals in main.c is kept in a GameState and passed around explicitly, so
+// the same code can drive the SDL client and headless simulations.
+
+enum TileColor {
+  LIGHT_BLUE,
+  YELLOW,
+  PINK,
+  BLUE,
+  ORANGE,
+  GREEN,
+  RED,
+  GARBAGE, // rows pushed in from below rather than placed
+};
+
+#define TILE_COLOR_COUNT 8
+
+enum GameInput {
+  INPUT_NONE,
+  INPUT_ROTATE,
+  INPUT_LEFT,
+  INPUT_RIGHT,
+  INPUT_DOWN,
+  INPUT_HARD_DROP,
+  INPUT_PAUSE,
+  INPUT_GRAVITY,
+};
+
+#define GAME_CACHE_LINE_SIZE 64
+
+// A complete, self-contained game. It holds no pointers, so a plain struct
+// copy forks a game, and it is padded to whole cache lines so games packed in
+// an array (one per worker, or thousands per process) never share a line.
+typedef struct GameState {
+  uint8_t board[16];
+  // Cell colors as three bit planes laid out like `board`: bit i of a
+  // filled cell's color is set in colors[i]. Empty cells are clear in all
+  // three, so line clears compact the planes exactly like the board.
+  uint8_t colors[3][16];
+  Skyline skyline;
+  uint32_t board_revision; // bumped whenever a piece locks or rows clear
+
+  Piece falling_piece;
+  int32_t falling_piece_x;
+  int32_t falling_piece_y;
+  int32_t ghost_y; // where the falling piece would land, kept up to date by step
+
+  Piece piece_queue[3];
+  Piece held_piece;
+  bool has_held_piece;
+  Rng rng;
+  PieceBag bag;
+
+  uint64_t score;
+  uint32_t lines;
+  uint32_t pieces; // locked so far, so the falling piece's index is pieces + 1
+  bool paused;
+  bool game_over;
+} __attribute__((aligned(GAME_CACHE_LINE_SIZE))) GameState;
+
+// Color of a filled cell. `x` counts from the left, like piece positions.
+static inline enum TileColor tile_color(const GameState *state, int32_t x, int32_t y) {
+  uint8_t bit = 0b10000000 >> x;
+
+  return (enum TileColor)((state->colors[0][y] & bit ? 1 : 0) |
+                          (state->colors[1][y] & bit ? 2 : 0) |
+                          (state->colors[2][y] & bit ? 4 : 0));
+}
+
+// Starts a game whose pieces are drawn from `seed`; the same seed and the
+// same inputs always play out the same game.
+void game_init(GameState *state, uint64_t seed);
+
+// Allocates `count` cache-line aligned games. Each one still needs game_init.
+GameState *game_alloc(size_t count);
+void game_free(GameState *states);
+
+// Applies a single input to the game. Returns true if anything changed.
+bool step(GameState *state, enum GameInput input);
+
+// Milliseconds until the next INPUT_GRAVITY should be applied.
+uint32_t gravity_interval(const GameState *state);
+
+// How many rows the falling piece can fall before it lands.
+int32_t drop_distance(const GameState *state);
+
+bool check_collision(const GameState *state, enum PieceType type, uint8_t rotation,
+                     int32_t x, int32_t y);
+bool check_collision_packed(const GameState *state, enum PieceType type,
+                            uint8_t rotation, int32_t x, int32_t y);
+// Reference version that shifts an arbitrary representation row by row.
+bool check_collision_repr(const GameState *state, const PieceRepresentation repr,
+                          int32_t x, int32_t y);
+Piece new_piece(enum PieceType type);
+bool rotate_piece(GameState *state);
+bool try_move(GameState *state, int32_t delta_x, int32_t delta_y);
+void pop_queue(GameState *state);
+void check_board(GameState *state);
+
+// Pushes `rows` rows of garbage in from below, raising the stack. Each one
+// is full but for a hole at column `hole_x`, 0 to 7. The falling piece is
+// lifted with the stack if it has to be; anything pushed off the top, or a
+// piece that can't be lifted clear, ends the game. Does nothing while paused.
+void insert_garbage(GameState *state, int32_t rows, int32_t hole_x);
+
+#endif
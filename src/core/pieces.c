@@ -0,0 +1,180 @@
+#include "pieces.h"
+
+// Each list holds the rotations of one piece, top row first. Cells are the
+// high bits of a row so that x = 0 is flush with the left wall.
+
+#define PT_J_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b10000000,                 \
+    0b11100000,                 \
+    0b00000000)                 \
+  X(0b00000000,                 \
+    0b01100000,                 \
+    0b01000000,                 \
+    0b01000000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11100000,                 \
+    0b00100000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b01000000,                 \
+    0b11000000)
+
+#define PT_L_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b00100000,                 \
+    0b11100000,                 \
+    0b00000000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b01000000,                 \
+    0b01100000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11100000,                 \
+    0b10000000)                 \
+  X(0b00000000,                 \
+    0b11000000,                 \
+    0b01000000,                 \
+    0b01000000)
+
+#define PT_T_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b11100000,                 \
+    0b00000000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b01100000,                 \
+    0b01000000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11100000,                 \
+    0b01000000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b11000000,                 \
+    0b01000000)
+
+#define PT_I_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11110000,                 \
+    0b00000000)                 \
+  X(0b00100000,                 \
+    0b00100000,                 \
+    0b00100000,                 \
+    0b00100000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11110000,                 \
+    0b00000000)                 \
+  X(0b01000000,                 \
+    0b01000000,                 \
+    0b01000000,                 \
+    0b01000000)
+
+#define PT_S_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b01100000,                 \
+    0b11000000,                 \
+    0b00000000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b01100000,                 \
+    0b00100000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b01100000,                 \
+    0b11000000)                 \
+  X(0b00000000,                 \
+    0b10000000,                 \
+    0b11000000,                 \
+    0b01000000)
+
+#define PT_Z_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b11000000,                 \
+    0b01100000,                 \
+    0b00000000)                 \
+  X(0b00000000,                 \
+    0b00100000,                 \
+    0b01100000,                 \
+    0b01000000)                 \
+  X(0b00000000,                 \
+    0b00000000,                 \
+    0b11000000,                 \
+    0b01100000)                 \
+  X(0b00000000,                 \
+    0b01000000,                 \
+    0b11000000,                 \
+    0b10000000)
+
+#define PT_O_SHAPES(X)          \
+  X(0b00000000,                 \
+    0b01100000,                 \
+    0b01100000,                 \
+    0b00000000)
+
+#define SHAPE_ROTATION(r0, r1, r2, r3) {r0, r1, r2, r3},
+#define SHAPE_COUNT(r0, r1, r2, r3) +1
+
+#define ROTATIONS(shapes) {(0 shapes(SHAPE_COUNT)), {shapes(SHAPE_ROTATION)}}
+
+const PieceRotationDescriptor ROTATION_DESCRIPTORS[7] = {
+    [PT_I] = ROTATIONS(PT_I_SHAPES), [PT_O] = ROTATIONS(PT_O_SHAPES),
+    [PT_T] = ROTATIONS(PT_T_SHAPES), [PT_J] = ROTATIONS(PT_J_SHAPES),
+    [PT_L] = ROTATIONS(PT_L_SHAPES), [PT_S] = ROTATIONS(PT_S_SHAPES),
+    [PT_Z] = ROTATIONS(PT_Z_SHAPES),
+};
+
+// A row shifted to column x, widened so that the playfield is bits 8-15 and
+// anything outside of it means the row went through a wall.
+#define WIDE_ROW(row, x) ((uint32_t)(row) << (8 - (x)))
+#define ROW_AT(row, x) ((uint8_t)(WIDE_ROW(row, x) >> 8))
+#define ROW_FITS(row, x) ((WIDE_ROW(row, x) & ~0xFF00u) == 0)
+
+#define PACKED_ROWS(r0, r1, r2, r3, x)                                        \
+  ((uint32_t)ROW_AT(r0, x) | (uint32_t)ROW_AT(r1, x) << 8 |                   \
+   (uint32_t)ROW_AT(r2, x) << 16 | (uint32_t)ROW_AT(r3, x) << 24)
+
+#define FIRST_ROW(r0, r1, r2, r3) ((r0) ? 0 : (r1) ? 1 : (r2) ? 2 : 3)
+#define LAST_ROW(r0, r1, r2, r3) ((r3) ? 3 : (r2) ? 2 : (r1) ? 1 : 0)
+
+#define COLUMN_BIT(c) (0x80 >> (c))
+#define LOWEST_CELL(r0, r1, r2, r3, c)                                        \
+  ((r3) & COLUMN_BIT(c)   ? 3                                                 \
+   : (r2) & COLUMN_BIT(c) ? 2                                                 \
+   : (r1) & COLUMN_BIT(c) ? 1                                                 \
+   : (r0) & COLUMN_BIT(c) ? 0                                                 \
+                          : -1)
+
+#define COLLISION_ENTRY(r0, r1, r2, r3, x)                                    \
+  {                                                                          \
+    {ROW_AT(r0, x), ROW_AT(r1, x), ROW_AT(r2, x), ROW_AT(r3, x)},            \
+    PACKED_ROWS(r0, r1, r2, r3, x),                                          \
+    ROW_FITS(r0, x) && ROW_FITS(r1, x) && ROW_FITS(r2, x) && ROW_FITS(r3, x), \
+    FIRST_ROW(r0, r1, r2, r3), LAST_ROW(r0, r1, r2, r3),                     \
+    {LOWEST_CELL(r0, r1, r2, r3, 0), LOWEST_CELL(r0, r1, r2, r3, 1),          \
+     LOWEST_CELL(r0, r1, r2, r3, 2), LOWEST_CELL(r0, r1, r2, r3, 3)},         \
+  }
+
+#define COLLISION_ROTATION(r0, r1, r2, r3)                                    \
+  {                                                                          \
+    COLLISION_ENTRY(r0, r1, r2, r3, -3), COLLISION_ENTRY(r0, r1, r2, r3, -2), \
+    COLLISION_ENTRY(r0, r1, r2, r3, -1), COLLISION_ENTRY(r0, r1, r2, r3, 0),  \
+    COLLISION_ENTRY(r0, r1, r2, r3, 1), COLLISION_ENTRY(r0, r1, r2, r3, 2),   \
+    COLLISION_ENTRY(r0, r1, r2, r3, 3), COLLISION_ENTRY(r0, r1, r2, r3, 4),   \
+    COLLISION_ENTRY(r0, r1, r2, r3, 5), COLLISION_ENTRY(r0, r1, r2, r3, 6),   \
+    COLLISION_ENTRY(r0, r1, r2, r3, 7),                                       \
+  },
+
+const CollisionMask COLLISION_MASKS[7][4][COLLISION_X_COUNT] = {
+    [PT_I] = {PT_I_SHAPES(COLLISION_ROTATION)}, [PT_O] = {PT_O_SHAPES(COLLISION_ROTATION)},
+    [PT_T] = {PT_T_SHAPES(COLLISION_ROTATION)}, [PT_J] = {PT_J_SHAPES(COLLISION_ROTATION)},
+    [PT_L] = {PT_L_SHAPES(COLLISION_ROTATION)}, [PT_S] = {PT_S_SHAPES(COLLISION_ROTATION)},
+    [PT_Z] = {PT_Z_SHAPES(COLLISION_ROTATION)},
+};
+
+const CollisionMask ILLEGAL_COLLISION_MASK = {{0, 0, 0, 0}, 0, false, 0, 0, {-1, -1, -1, -1}};
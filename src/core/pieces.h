@@ -0,0 +1,95 @@
+#ifndef BRICKGAME_CORE_PIECES_H
+#define BRICKGAME_CORE_PIECES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "board.h"
+
+enum PieceType {
+  PT_I,
+  PT_O,
+  PT_T,
+  PT_J,
+  PT_L,
+  PT_S,
+  PT_Z,
+};
+
+typedef uint8_t PieceRepresentation[4];
+
+typedef struct PieceRotationDescriptor {
+  uint8_t count;
+  PieceRepresentation rotations[4];
+} PieceRotationDescriptor;
+
+typedef struct Piece {
+  enum PieceType type;
+  uint8_t rotation;
+  PieceRepresentation repr_cache;
+} Piece;
+
+extern const PieceRotationDescriptor ROTATION_DESCRIPTORS[7];
+
+// Every rotation of every piece pre-shifted to every column it can be placed
+// at, so testing a placement needs no shifting at all. x runs from
+// COLLISION_X_MIN, where the rightmost column of the 4x4 shape is at the left
+// wall, to 7.
+#define COLLISION_X_MIN -3
+#define COLLISION_X_COUNT 11
+
+typedef struct CollisionMask {
+  uint8_t rows[4];
+  uint32_t packed; // rows as one word, first row in the low byte
+  bool legal; // false if a cell sticks out past one of the walls
+  uint8_t top; // first and last non-empty row of the shape
+  uint8_t bottom;
+  int8_t profile[4]; // lowest cell of each column of the shape, -1 if empty
+} CollisionMask;
+
+extern const CollisionMask COLLISION_MASKS[7][4][COLLISION_X_COUNT];
+extern const CollisionMask ILLEGAL_COLLISION_MASK;
+
+static inline const CollisionMask *collision_mask(enum PieceType type, uint8_t rotation,
+                                                  int32_t x) {
+  if (x < COLLISION_X_MIN || x >= COLLISION_X_MIN + COLLISION_X_COUNT)
+    return &ILLEGAL_COLLISION_MASK;
+
+  return &COLLISION_MASKS[type][rotation][x - COLLISION_X_MIN];
+}
+
+// Rows outside of [top, bottom] are empty in the mask, so wrapping their
+// index keeps the loads in bounds without affecting the result.
+static inline bool mask_collides(const uint8_t board[16], const CollisionMask *mask,
+                                 int32_t y) {
+  if (!mask->legal || y + mask->top < 0 || y + mask->bottom >= 16)
+    return true;
+
+  return ((board[y & 15] & mask->rows[0]) | (board[(y + 1) & 15] & mask->rows[1]) |
+          (board[(y + 2) & 15] & mask->rows[2]) | (board[(y + 3) & 15] & mask->rows[3])) != 0;
+}
+
+// Same test as mask_collides, but against a packed window of the board.
+static inline bool packed_collides(const uint8_t board[16], const CollisionMask *mask,
+                                   int32_t y) {
+  return !mask->legal || (board_window(board, y) & mask->packed) != 0;
+}
+
+// Tests the five placements y..y+4 against one window. Bit k of the result
+// is set if the piece collides at y + k.
+static inline uint32_t packed_collisions(const uint8_t board[16], const CollisionMask *mask,
+                                         int32_t y) {
+  if (!mask->legal)
+    return 0x1F;
+
+  uint64_t window = board_window(board, y);
+  uint64_t piece = mask->packed;
+  uint32_t hits = 0;
+
+  for (int k = 0; k < 5; k++)
+    hits |= (uint32_t)((window & (piece << (k * 8))) != 0) << k;
+
+  return hits;
+}
+
+#endif
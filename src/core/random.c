@@ -0,0 +1,43 @@
+#include "random.h"
+
+// splitmix64, the recommended way to spread a single seed over xoshiro's
+// state; it never produces the all-zero state xoshiro can't leave.
+static uint64_t splitmix64(uint64_t *x) {
+  uint64_t z = (*x += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+void rng_seed(Rng *rng, uint64_t seed) {
+  uint64_t a = splitmix64(&seed);
+  uint64_t b = splitmix64(&seed);
+
+  rng->s[0] = (uint32_t)a;
+  rng->s[1] = (uint32_t)(a >> 32);
+  rng->s[2] = (uint32_t)b;
+  rng->s[3] = (uint32_t)(b >> 32);
+}
+
+void bag_init(PieceBag *bag) {
+  bag->remaining = 0;
+}
+
+enum PieceType bag_next(PieceBag *bag, Rng *rng) {
+  if (!bag->remaining) {
+    for (int i = 0; i < 7; i++)
+      bag->pieces[i] = (uint8_t)i;
+
+    // Fisher-Yates
+    for (int i = 6; i > 0; i--) {
+      uint32_t j = rng_below(rng, i + 1);
+      uint8_t swap = bag->pieces[i];
+      bag->pieces[i] = bag->pieces[j];
+      bag->pieces[j] = swap;
+    }
+
+    bag->remaining = 7;
+  }
+
+  return (enum PieceType)bag->pieces[--bag->remaining];
+}
@@ -0,0 +1,62 @@
+#ifndef BRICKGAME_CORE_RANDOM_H
+#define BRICKGAME_CORE_RANDOM_H
+
+#include <stdint.h>
+
+#include "pieces.h"
+
+// xoshiro128**: 16 bytes of state, fast, and good enough for shuffling
+// pieces. Every game owns one, so games are reproducible from their seed and
+// any number of them can run side by side.
+typedef struct Rng {
+  uint32_t s[4];
+} Rng;
+
+// The standard 7-bag: each run of seven pieces is one of every type in a
+// shuffled order.
+typedef struct PieceBag {
+  uint8_t pieces[7];
+  uint8_t remaining;
+} PieceBag;
+
+void rng_seed(Rng *rng, uint64_t seed);
+
+static inline uint32_t rng_rotl(uint32_t x, int k) {
+  return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t rng_next(Rng *rng) {
+  uint32_t *s = rng->s;
+  uint32_t result = rng_rotl(s[1] * 5, 7) * 9;
+  uint32_t t = s[1] << 9;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rng_rotl(s[3], 11);
+
+  return result;
+}
+
+// Uniform in [0, bound), without the bias of a plain modulo (Lemire's
+// multiply and reject).
+static inline uint32_t rng_below(Rng *rng, uint32_t bound) {
+  uint64_t m = (uint64_t)rng_next(rng) * bound;
+
+  if ((uint32_t)m < bound) {
+    uint32_t threshold = -bound % bound;
+    while ((uint32_t)m < threshold)
+      m = (uint64_t)rng_next(rng) * bound;
+  }
+
+  return (uint32_t)(m >> 32);
+}
+
+void bag_init(PieceBag *bag);
+
+// Draws the next piece, refilling and shuffling a whole bag when it runs out.
+enum PieceType bag_next(PieceBag *bag, Rng *rng);
+
+#endif
@@ -0,0 +1,467 @@
+#include "replay.h"
+
+#include <string.h>
+
+static size_t encode_varint(uint64_t value, uint8_t *out) {
+  size_t size = 0;
+
+  while (value >= 0x80) {
+    out[size++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[size++] = (uint8_t)value;
+
+  return size;
+}
+
+static bool decode_varint(ReplayReader *reader, uint64_t *value) {
+  uint64_t result = 0;
+
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (reader->offset >= reader->size)
+      return false;
+
+    uint8_t byte = reader->data[reader->offset++];
+    result |= (uint64_t)(byte & 0x7F) << shift;
+
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool read_bytes(ReplayReader *reader, void *out, size_t size) {
+  if (reader->size - reader->offset < size)
+    return false;
+
+  memcpy(out, reader->data + reader->offset, size);
+  reader->offset += size;
+  return true;
+}
+
+static size_t encode_zigzag(int32_t value, uint8_t *out) {
+  return encode_varint(((uint32_t)value << 1) ^ (uint32_t)(value >> 31), out);
+}
+
+static bool decode_zigzag(ReplayReader *reader, int32_t *value) {
+  uint64_t zigzag;
+  if (!decode_varint(reader, &zigzag) || zigzag > UINT32_MAX)
+    return false;
+
+  *value = (int32_t)((uint32_t)zigzag >> 1 ^ -(uint32_t)(zigzag & 1));
+  return true;
+}
+
+static void store_u32(uint32_t value, uint8_t *out) {
+  for (int i = 0; i < 4; i++)
+    out[i] = (uint8_t)(value >> i * 8);
+}
+
+static void store_u64(uint64_t value, uint8_t *out) {
+  for (int i = 0; i < 8; i++)
+    out[i] = (uint8_t)(value >> i * 8);
+}
+
+static uint32_t load_u32(const uint8_t *in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; i++)
+    value |= (uint32_t)in[i] << i * 8;
+  return value;
+}
+
+static uint64_t load_u64(const uint8_t *in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++)
+    value |= (uint64_t)in[i] << i * 8;
+  return value;
+}
+
+size_t replay_encode_header(const ReplayHeader *header, uint8_t *out) {
+  size_t size = 0;
+
+  memcpy(out, REPLAY_MAGIC, 4);
+  size += 4;
+  out[size++] = REPLAY_VERSION;
+  size += encode_varint(header->seed, out + size);
+  size += encode_varint(header->tick_rate, out + size);
+  size += encode_varint(header->keyframe_interval, out + size);
+
+  return size;
+}
+
+static size_t encode_tag(uint64_t *last_tick, uint64_t tick, enum GameInput input,
+                         uint8_t *out) {
+  uint64_t delta = tick - *last_tick;
+  *last_tick = tick;
+
+  return encode_varint(delta << 3 | (uint64_t)input, out);
+}
+
+size_t replay_encode_event(uint64_t *last_tick, uint64_t tick, enum GameInput input,
+                           uint8_t *out) {
+  return encode_tag(last_tick, tick, input, out);
+}
+
+size_t replay_encode_end(uint64_t *last_tick, uint64_t tick, const ReplayTrailer *trailer,
+                         uint8_t *out) {
+  size_t size = encode_tag(last_tick, tick, INPUT_NONE, out);
+
+  size += encode_varint(REPLAY_CONTROL_END, out + size);
+  size += encode_varint(trailer->score, out + size);
+  size += encode_varint(trailer->lines, out + size);
+  size += encode_varint(trailer->pieces, out + size);
+
+  return size;
+}
+
+// A piece is its type and rotation, in one byte.
+static uint8_t encode_piece(const Piece *piece) {
+  return (uint8_t)(piece->type | piece->rotation << 3);
+}
+
+static bool decode_piece(uint8_t byte, Piece *piece) {
+  enum PieceType type = (enum PieceType)(byte & 7);
+  uint8_t rotation = byte >> 3;
+
+  if (type >= 7 || rotation >= ROTATION_DESCRIPTORS[type].count)
+    return false;
+
+  *piece = new_piece(type);
+  piece->rotation = rotation;
+  memcpy(&piece->repr_cache, &ROTATION_DESCRIPTORS[type].rotations[rotation], 4);
+  return true;
+}
+
+enum KeyframeFlag {
+  KEYFRAME_PAUSED = 1,
+  KEYFRAME_GAME_OVER = 2,
+  KEYFRAME_HAS_HELD_PIECE = 4,
+};
+
+size_t replay_encode_keyframe(uint64_t *last_tick, uint64_t tick, const GameState *state,
+                              uint8_t *out) {
+  size_t size = encode_tag(last_tick, tick, INPUT_NONE, out);
+  size += encode_varint(REPLAY_CONTROL_KEYFRAME, out + size);
+
+  out[size++] = (uint8_t)((state->paused ? KEYFRAME_PAUSED : 0) |
+                          (state->game_over ? KEYFRAME_GAME_OVER : 0) |
+                          (state->has_held_piece ? KEYFRAME_HAS_HELD_PIECE : 0));
+
+  memcpy(out + size, state->board, 16);
+  size += 16;
+
+  memcpy(out + size, state->colors, sizeof(state->colors));
+  size += sizeof(state->colors);
+
+  out[size++] = encode_piece(&state->falling_piece);
+  for (int i = 0; i < 3; i++)
+    out[size++] = encode_piece(&state->piece_queue[i]);
+  out[size++] = state->has_held_piece ? encode_piece(&state->held_piece) : 0;
+  size += encode_zigzag(state->falling_piece_x, out + size);
+  size += encode_zigzag(state->falling_piece_y, out + size);
+
+  for (int i = 0; i < 4; i++) {
+    store_u32(state->rng.s[i], out + size);
+    size += 4;
+  }
+  memcpy(out + size, state->bag.pieces, 7);
+  size += 7;
+  out[size++] = state->bag.remaining;
+
+  size += encode_varint(state->score, out + size);
+  size += encode_varint(state->lines, out + size);
+  size += encode_varint(state->pieces, out + size);
+  size += encode_varint(state->board_revision, out + size);
+
+  return size;
+}
+
+// Reads a keyframe's state, after its tag and control. Anything that could
+// send the rules out of bounds, like a piece overlapping the stack, is
+// rejected.
+static bool decode_keyframe(ReplayReader *reader, GameState *state) {
+  uint8_t flags;
+  uint8_t pieces[5];
+  uint8_t rng[16];
+  uint64_t score;
+  uint64_t lines;
+  uint64_t locked;
+  uint64_t revision;
+
+  memset(state, 0, sizeof(GameState));
+
+  if (!read_bytes(reader, &flags, 1) || !read_bytes(reader, state->board, 16) ||
+      !read_bytes(reader, state->colors, sizeof(state->colors)) || !read_bytes(reader, pieces, 5) ||
+      !decode_zigzag(reader, &state->falling_piece_x) ||
+      !decode_zigzag(reader, &state->falling_piece_y) || !read_bytes(reader, rng, 16) ||
+      !read_bytes(reader, state->bag.pieces, 7) || !read_bytes(reader, &state->bag.remaining, 1) ||
+      !decode_varint(reader, &score) || !decode_varint(reader, &lines) ||
+      !decode_varint(reader, &locked) || !decode_varint(reader, &revision))
+    return false;
+
+  state->paused = flags & KEYFRAME_PAUSED;
+  state->game_over = flags & KEYFRAME_GAME_OVER;
+  state->has_held_piece = flags & KEYFRAME_HAS_HELD_PIECE;
+
+  // Colors only on filled cells
+  for (int y = 0; y < 16; y++) {
+    uint8_t any = state->colors[0][y] | state->colors[1][y] | state->colors[2][y];
+    if (any & ~state->board[y])
+      return false;
+  }
+
+  if (!decode_piece(pieces[0], &state->falling_piece) ||
+      !decode_piece(pieces[1], &state->piece_queue[0]) ||
+      !decode_piece(pieces[2], &state->piece_queue[1]) ||
+      !decode_piece(pieces[3], &state->piece_queue[2]) ||
+      (state->has_held_piece && !decode_piece(pieces[4], &state->held_piece)))
+    return false;
+
+  for (int i = 0; i < 4; i++)
+    state->rng.s[i] = load_u32(&rng[i * 4]);
+
+  if (state->bag.remaining > 7)
+    return false;
+  for (int i = 0; i < 7; i++) {
+    if (state->bag.pieces[i] >= 7)
+      return false;
+  }
+
+  if (lines > UINT32_MAX || locked > UINT32_MAX || revision > UINT32_MAX)
+    return false;
+  state->score = score;
+  state->lines = (uint32_t)lines;
+  state->pieces = (uint32_t)locked;
+  state->board_revision = (uint32_t)revision;
+
+  // The falling piece must be inside the board. Only a finished game's last
+  // piece may overlap the stack, since it never moves.
+  const Piece *piece = &state->falling_piece;
+  const CollisionMask *mask = collision_mask(piece->type, piece->rotation, state->falling_piece_x);
+  if (!mask->legal || state->falling_piece_y + mask->top < 0 ||
+      state->falling_piece_y + mask->bottom >= 16)
+    return false;
+  if (!state->game_over && check_collision(state, piece->type, piece->rotation,
+                                           state->falling_piece_x, state->falling_piece_y))
+    return false;
+
+  skyline_rebuild(&state->skyline, state->board);
+  state->ghost_y = state->falling_piece_y + drop_distance(state);
+
+  return true;
+}
+
+// Passes over a keyframe's state without decoding it, for plain playback.
+// Mirrors the layout written by replay_encode_keyframe.
+static bool skip_keyframe(ReplayReader *reader) {
+  static const size_t BEFORE_POSITION = 1 + 16 + 48 + 5; // flags, board, colors, pieces
+  static const size_t BEFORE_SCORE = 16 + 8;             // generator, bag
+  uint64_t value;
+
+  if (reader->size - reader->offset < BEFORE_POSITION)
+    return false;
+  reader->offset += BEFORE_POSITION;
+
+  for (int i = 0; i < 2; i++) {
+    if (!decode_varint(reader, &value))
+      return false;
+  }
+
+  if (reader->size - reader->offset < BEFORE_SCORE)
+    return false;
+  reader->offset += BEFORE_SCORE;
+
+  // Score, lines, pieces and revision
+  for (int i = 0; i < 4; i++) {
+    if (!decode_varint(reader, &value))
+      return false;
+  }
+
+  return true;
+}
+
+size_t replay_encode_index_entry(uint64_t offset, uint64_t tick, uint8_t *out) {
+  store_u64(offset, out);
+  store_u64(tick, out + 8);
+
+  return REPLAY_INDEX_ENTRY_SIZE;
+}
+
+size_t replay_encode_index_footer(uint32_t count, uint32_t keyframe_interval, uint8_t *out) {
+  store_u32(count, out);
+  store_u32(keyframe_interval, out + 4);
+  memcpy(out + 8, REPLAY_INDEX_MAGIC, 4);
+
+  return REPLAY_INDEX_FOOTER_SIZE;
+}
+
+// Finds the index at the end of the file, if there is a plausible one.
+static void find_index(ReplayReader *reader) {
+  const uint8_t *data = reader->data;
+  size_t size = reader->size;
+
+  if (size - reader->start < REPLAY_INDEX_FOOTER_SIZE ||
+      memcmp(data + size - 4, REPLAY_INDEX_MAGIC, 4) != 0)
+    return;
+
+  uint32_t count = load_u32(data + size - REPLAY_INDEX_FOOTER_SIZE);
+  if (load_u32(data + size - 8) != reader->header.keyframe_interval ||
+      count > (size - reader->start - REPLAY_INDEX_FOOTER_SIZE) / REPLAY_INDEX_ENTRY_SIZE)
+    return;
+
+  size_t index_offset = size - REPLAY_INDEX_FOOTER_SIZE - (size_t)count * REPLAY_INDEX_ENTRY_SIZE;
+  const uint8_t *index = data + index_offset;
+
+  // Keyframes must be in order and lie in the records before the index
+  uint64_t previous = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t offset = load_u64(index + i * REPLAY_INDEX_ENTRY_SIZE);
+    if (offset < reader->start || offset >= index_offset || offset < previous)
+      return;
+    previous = offset;
+  }
+
+  reader->index = index;
+  reader->keyframe_count = count;
+}
+
+bool replay_reader_init(ReplayReader *reader, const uint8_t *data, size_t size) {
+  memset(reader, 0, sizeof(ReplayReader));
+  reader->data = data;
+  reader->size = size;
+
+  if (size < 5 || memcmp(data, REPLAY_MAGIC, 4) != 0 || data[4] != REPLAY_VERSION)
+    return false;
+  reader->offset = 5;
+
+  uint64_t tick_rate;
+  uint64_t keyframe_interval;
+  if (!decode_varint(reader, &reader->header.seed) || !decode_varint(reader, &tick_rate) ||
+      !decode_varint(reader, &keyframe_interval) || tick_rate < REPLAY_MIN_TICK_RATE ||
+      tick_rate > REPLAY_MAX_TICK_RATE || keyframe_interval > UINT32_MAX)
+    return false;
+  reader->header.tick_rate = (uint32_t)tick_rate;
+  reader->header.keyframe_interval = (uint32_t)keyframe_interval;
+  reader->start = reader->offset;
+
+  find_index(reader);
+
+  return true;
+}
+
+enum ReplayRecord replay_next(ReplayReader *reader, uint64_t *tick, enum GameInput *input) {
+  uint64_t tag;
+  uint64_t control;
+
+  while (true) {
+    if (!decode_varint(reader, &tag))
+      return REPLAY_RECORD_ERROR;
+
+    reader->tick += tag >> 3;
+
+    if ((tag & 7) != INPUT_NONE) {
+      *tick = reader->tick;
+      *input = (enum GameInput)(tag & 7);
+      return REPLAY_RECORD_EVENT;
+    }
+
+    if (!decode_varint(reader, &control))
+      return REPLAY_RECORD_ERROR;
+    if (control != REPLAY_CONTROL_KEYFRAME)
+      break;
+
+    if (!skip_keyframe(reader))
+      return REPLAY_RECORD_ERROR;
+  }
+
+  if (control != REPLAY_CONTROL_END)
+    return REPLAY_RECORD_ERROR;
+
+  uint64_t lines;
+  uint64_t pieces;
+  if (!decode_varint(reader, &reader->trailer.score) || !decode_varint(reader, &lines) ||
+      !decode_varint(reader, &pieces) || lines > UINT32_MAX || pieces > UINT32_MAX)
+    return REPLAY_RECORD_ERROR;
+
+  reader->trailer.lines = (uint32_t)lines;
+  reader->trailer.pieces = (uint32_t)pieces;
+
+  return REPLAY_RECORD_END;
+}
+
+bool replay_seek(ReplayReader *reader, GameState *state, uint64_t tick) {
+  // Last keyframe at or before `tick`
+  uint32_t low = 0;
+  uint32_t high = reader->keyframe_count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (load_u64(reader->index + middle * REPLAY_INDEX_ENTRY_SIZE + 8) <= tick)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  if (low == 0) {
+    reader->offset = reader->start;
+    reader->tick = 0;
+    game_init(state, reader->header.seed);
+  } else {
+    const uint8_t *entry = reader->index + (low - 1) * REPLAY_INDEX_ENTRY_SIZE;
+    reader->offset = (size_t)load_u64(entry);
+
+    // The tag's delta is relative to a record we skipped, the index has the
+    // absolute tick
+    uint64_t tag;
+    uint64_t control;
+    if (!decode_varint(reader, &tag) || (tag & 7) != INPUT_NONE ||
+        !decode_varint(reader, &control) || control != REPLAY_CONTROL_KEYFRAME ||
+        !decode_keyframe(reader, state))
+      return false;
+    reader->tick = load_u64(entry + 8);
+  }
+
+  while (true) {
+    size_t offset = reader->offset;
+    uint64_t reader_tick = reader->tick;
+    uint64_t event_tick;
+    enum GameInput input;
+
+    enum ReplayRecord record = replay_next(reader, &event_tick, &input);
+    if (record == REPLAY_RECORD_ERROR)
+      return false;
+
+    // Leave the next event, or the end, to be read again
+    if (record == REPLAY_RECORD_END || event_tick > tick) {
+      reader->offset = offset;
+      reader->tick = reader_tick;
+      return true;
+    }
+
+    step(state, input);
+  }
+}
+
+bool replay_simulate(const uint8_t *data, size_t size, GameState *state,
+                     ReplayTrailer *claimed) {
+  ReplayReader reader;
+  if (!replay_reader_init(&reader, data, size))
+    return false;
+
+  game_init(state, reader.header.seed);
+
+  uint64_t tick;
+  enum GameInput input;
+  enum ReplayRecord record;
+
+  while ((record = replay_next(&reader, &tick, &input)) == REPLAY_RECORD_EVENT)
+    step(state, input);
+
+  if (record != REPLAY_RECORD_END)
+    return false;
+
+  *claimed = reader.trailer;
+  return true;
+}
@@ -0,0 +1,133 @@
+#ifndef BRICKGAME_CORE_REPLAY_H
+#define BRICKGAME_CORE_REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "game.h"
+
+// Replays are the seed plus every input step() was given, in order, so
+// re-simulating one reproduces the game exactly. The file is:
+//
+//   header:   "BRKR", version byte, varint seed, varint tick rate, varint
+//             keyframe interval
+//   events:   varint (ticks since the previous record << 3 | input)
+//   keyframe: varint (ticks since the previous record << 3 | INPUT_NONE),
+//             varint REPLAY_CONTROL_KEYFRAME, then the game state, see
+//             replay_encode_keyframe
+//   end:      varint (ticks since the previous record << 3 | INPUT_NONE),
+//             varint REPLAY_CONTROL_END, then the trailer: varint score,
+//             varint lines, varint pieces
+//   index:    one entry per keyframe, in order: 8 byte offset of the
+//             keyframe record, 8 byte tick, then 4 byte count, 4 byte
+//             keyframe interval and "BRKI", all little-endian
+//
+// Inputs fit in three bits, so an event a few ticks after the last one is a
+// single byte. INPUT_NONE is never recorded as an input, and introduces a
+// control record instead.
+//
+// A keyframe follows the step that locked every keyframe interval'th piece,
+// so seeking restores the last keyframe before the target and simulates at
+// most that many pieces. The index sits at a fixed distance from the end of
+// the file; a replay cut short (say, by a crash) has none and can still be
+// played from the start.
+
+#define REPLAY_MAGIC "BRKR"
+#define REPLAY_VERSION 2
+#define REPLAY_INDEX_MAGIC "BRKI"
+
+// Upper bound on any single encoded record.
+#define REPLAY_RECORD_MAX 256
+
+#define REPLAY_INDEX_ENTRY_SIZE 16
+#define REPLAY_INDEX_FOOTER_SIZE 12
+
+// Locked pieces between keyframes, unless the recorder picks otherwise.
+#define REPLAY_KEYFRAME_INTERVAL 50
+
+// Simulation ticks per second a game can be played, and so recorded, at.
+// Replays claiming anything else are rejected.
+#define REPLAY_MIN_TICK_RATE 1
+#define REPLAY_MAX_TICK_RATE 10000
+
+enum ReplayControl {
+  REPLAY_CONTROL_END,
+  REPLAY_CONTROL_KEYFRAME,
+};
+
+typedef struct ReplayHeader {
+  uint64_t seed;
+  uint32_t tick_rate;
+  uint32_t keyframe_interval;
+} ReplayHeader;
+
+// What the game ended with, as claimed by whoever recorded it.
+typedef struct ReplayTrailer {
+  uint64_t score;
+  uint32_t lines;
+  uint32_t pieces;
+} ReplayTrailer;
+
+// Writes into `out`, which must have room for REPLAY_RECORD_MAX bytes, and
+// returns the number of bytes written. `last_tick` carries the timestamp of
+// the previous record between calls and starts at 0.
+size_t replay_encode_header(const ReplayHeader *header, uint8_t *out);
+size_t replay_encode_event(uint64_t *last_tick, uint64_t tick, enum GameInput input,
+                           uint8_t *out);
+size_t replay_encode_end(uint64_t *last_tick, uint64_t tick, const ReplayTrailer *trailer,
+                         uint8_t *out);
+
+// Everything needed to carry on from `state`: the board and its colors as
+// three bit planes of the piece type, the falling, queued and held pieces,
+// the generator and the score. What can be derived, like the skyline and
+// the ghost, is rebuilt instead.
+size_t replay_encode_keyframe(uint64_t *last_tick, uint64_t tick, const GameState *state,
+                              uint8_t *out);
+
+// The index goes after the end record: every entry, then the footer.
+size_t replay_encode_index_entry(uint64_t offset, uint64_t tick, uint8_t *out);
+size_t replay_encode_index_footer(uint32_t count, uint32_t keyframe_interval, uint8_t *out);
+
+enum ReplayRecord {
+  REPLAY_RECORD_EVENT,
+  REPLAY_RECORD_END,
+  REPLAY_RECORD_ERROR, // truncated or malformed
+};
+
+// Walks a replay held in memory. Never reads outside `data`, so it's safe
+// on untrusted files.
+typedef struct ReplayReader {
+  const uint8_t *data;
+  size_t size;
+  size_t offset;
+  uint64_t tick;
+  size_t start; // offset of the first record
+
+  const uint8_t *index; // NULL without a valid index
+  uint32_t keyframe_count;
+
+  ReplayHeader header;
+  ReplayTrailer trailer; // valid once replay_next returned REPLAY_RECORD_END
+} ReplayReader;
+
+// Parses the header. Returns false if this isn't a replay we can read, or one
+// recorded at a tick rate outside REPLAY_MIN_TICK_RATE..REPLAY_MAX_TICK_RATE.
+bool replay_reader_init(ReplayReader *reader, const uint8_t *data, size_t size);
+
+// Reads the next record, passing over keyframes. For REPLAY_RECORD_EVENT,
+// `tick` and `input` are set.
+enum ReplayRecord replay_next(ReplayReader *reader, uint64_t *tick, enum GameInput *input);
+
+// Puts `state` where the game was after every event up to and including
+// `tick`, restoring the last keyframe before it when the replay has an
+// index, and leaves the reader at the first event after it. Returns false
+// if the replay is malformed.
+bool replay_seek(ReplayReader *reader, GameState *state, uint64_t tick);
+
+// Re-simulates a whole replay into `state` as fast as possible. Returns
+// false if the replay is malformed; `claimed` gets its trailer.
+bool replay_simulate(const uint8_t *data, size_t size, GameState *state,
+                     ReplayTrailer *claimed);
+
+#endif
@@ -0,0 +1,92 @@
+#include "skyline.h"
+
+#include "board.h"
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+static void update_column_stats(Skyline *skyline) {
+  for (int x = 0; x < 8; x++) {
+    uint16_t column = skyline->columns[x];
+
+    skyline->heights[x] = column ? 16 - __builtin_ctz(column) : 0;
+    skyline->holes[x] = skyline->heights[x] - __builtin_popcount(column);
+  }
+
+  // The walls count as full columns
+  for (int x = 0; x < 8; x++) {
+    int left = x > 0 ? skyline->heights[x - 1] : 16;
+    int right = x < 7 ? skyline->heights[x + 1] : 16;
+    int edge = left < right ? left : right;
+
+    skyline->wells[x] = edge > skyline->heights[x] ? edge - skyline->heights[x] : 0;
+  }
+}
+
+void skyline_rebuild(Skyline *skyline, const uint8_t board[16]) {
+  board_columns(board, skyline->columns);
+  update_column_stats(skyline);
+}
+
+void skyline_add_piece(Skyline *skyline, const CollisionMask *mask, int32_t y) {
+  for (int i = mask->top; i <= mask->bottom; i++) {
+    uint32_t row = mask->rows[i];
+
+    while (row) {
+      int bit = 31 - __builtin_clz(row);
+      skyline->columns[7 - bit] |= 1 << (y + i);
+      row &= ~(1u << bit);
+    }
+  }
+
+  update_column_stats(skyline);
+}
+
+void skyline_clear_rows(Skyline *skyline, uint16_t cleared) {
+  for (int x = 0; x < 8; x++) {
+    uint32_t column = skyline->columns[x];
+
+#ifdef __BMI2__
+    column = _pext_u32(column, (uint16_t)~cleared) << __builtin_popcount(cleared);
+#else
+    // Going top to bottom, rows above the removed one drop by one and the
+    // rows still to be removed stay where they are
+    for (uint32_t rows = cleared; rows; rows &= rows - 1) {
+      int y = __builtin_ctz(rows);
+      column = (column & ~((2u << y) - 1)) | (column & ((1u << y) - 1)) << 1;
+    }
+#endif
+
+    skyline->columns[x] = (uint16_t)column;
+  }
+
+  update_column_stats(skyline);
+}
+
+void skyline_push_rows(Skyline *skyline, int count, uint8_t fill) {
+  uint32_t bottom = ((1u << count) - 1) << (16 - count);
+
+  for (int x = 0; x < 8; x++) {
+    uint32_t column = (uint32_t)skyline->columns[x] >> count;
+    if (fill & (0x80 >> x))
+      column |= bottom;
+    skyline->columns[x] = (uint16_t)column;
+  }
+
+  update_column_stats(skyline);
+}
+
+bool skyline_matches(const Skyline *skyline, const uint8_t board[16]) {
+  Skyline rescanned;
+  skyline_rebuild(&rescanned, board);
+
+  for (int x = 0; x < 8; x++) {
+    if (skyline->columns[x] != rescanned.columns[x] ||
+        skyline->heights[x] != rescanned.heights[x] ||
+        skyline->holes[x] != rescanned.holes[x] || skyline->wells[x] != rescanned.wells[x])
+      return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,27 @@
+#ifndef BRICKGAME_CORE_SKYLINE_H
+#define BRICKGAME_CORE_SKYLINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pieces.h"
+
+// Per-column view of the board, updated as pieces lock and rows clear so
+// nothing has to rescan the rows to ask about the stack.
+typedef struct Skyline {
+  uint16_t columns[8]; // bit y set if the cell at row y is filled
+  uint8_t heights[8];  // from the floor up to and including the top cell
+  uint8_t holes[8];    // empty cells under the top cell
+  uint8_t wells[8];    // how far the column is below its lower neighbour
+} Skyline;
+
+void skyline_rebuild(Skyline *skyline, const uint8_t board[16]);
+void skyline_add_piece(Skyline *skyline, const CollisionMask *mask, int32_t y);
+void skyline_clear_rows(Skyline *skyline, uint16_t cleared);
+// Follows push_rows.
+void skyline_push_rows(Skyline *skyline, int count, uint8_t fill);
+
+// Compares against a full rescan of `board`, for debug cross-checks.
+bool skyline_matches(const Skyline *skyline, const uint8_t board[16]);
+
+#endif
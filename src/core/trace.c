@@ -0,0 +1,155 @@
+#include "trace.h"
+
+#ifdef BRICK_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Single producer (the owning thread), single consumer (whoever flushes).
+typedef struct TraceRing {
+  TraceEvent events[TRACE_RING_SIZE];
+  uint32_t head __attribute__((aligned(64)));
+  uint32_t tail __attribute__((aligned(64)));
+
+  uint32_t thread_id;
+  const char *thread_name;
+  bool named; // thread name written to the file, flusher only
+  struct TraceRing *next;
+} TraceRing;
+
+static __thread TraceRing *thread_ring;
+static TraceRing *rings;
+static uint32_t thread_count;
+static bool tracing;
+
+static FILE *trace_file;
+static uint64_t trace_start_ns;
+static bool first_event;
+
+uint64_t trace_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+// Creates the calling thread's ring on first use and links it where the
+// flusher can find it. Rings live until the process exits, so a thread that
+// has finished can still be flushed.
+static TraceRing *get_thread_ring(void) {
+  if (thread_ring)
+    return thread_ring;
+
+  TraceRing *ring = (TraceRing *)calloc(1, sizeof(TraceRing));
+  if (!ring)
+    return NULL;
+
+  ring->thread_id = __atomic_add_fetch(&thread_count, 1, __ATOMIC_RELAXED);
+  ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+  while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, true, __ATOMIC_RELEASE,
+                                      __ATOMIC_RELAXED))
+    ;
+
+  thread_ring = ring;
+  return ring;
+}
+
+void trace_thread_name(const char *name) {
+  TraceRing *ring = get_thread_ring();
+
+  if (ring)
+    __atomic_store_n(&ring->thread_name, name, __ATOMIC_RELEASE);
+}
+
+void trace_record(const char *name, uint64_t begin_ns, uint64_t end_ns) {
+  if (!__atomic_load_n(&tracing, __ATOMIC_RELAXED))
+    return;
+
+  TraceRing *ring = get_thread_ring();
+  if (!ring)
+    return;
+
+  uint32_t head = ring->head;
+  if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) == TRACE_RING_SIZE)
+    return;
+
+  TraceEvent *event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+  event->name = name;
+  event->begin_ns = begin_ns;
+  event->end_ns = end_ns;
+
+  __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+bool trace_open(const char *path) {
+  trace_file = fopen(path, "w");
+  if (!trace_file)
+    return false;
+
+  // The JSON array format, which tolerates a missing closing bracket if the
+  // process dies before trace_close
+  fputs("[\n", trace_file);
+  first_event = true;
+  trace_start_ns = trace_now();
+  __atomic_store_n(&tracing, true, __ATOMIC_RELAXED);
+
+  return true;
+}
+
+static void write_separator(void) {
+  if (!first_event)
+    fputs(",\n", trace_file);
+  first_event = false;
+}
+
+void trace_flush(void) {
+  if (!trace_file)
+    return;
+
+  for (TraceRing *ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring; ring = ring->next) {
+    const char *thread_name = __atomic_load_n(&ring->thread_name, __ATOMIC_ACQUIRE);
+
+    if (thread_name && !ring->named) {
+      write_separator();
+      fprintf(trace_file,
+              "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+              "\"args\":{\"name\":\"%s\"}}",
+              ring->thread_id, thread_name);
+      ring->named = true;
+    }
+
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    for (; tail != head; tail++) {
+      const TraceEvent *event = &ring->events[tail & (TRACE_RING_SIZE - 1)];
+
+      // Spans that started before the trace was opened are cut at its start
+      uint64_t begin_ns = event->begin_ns > trace_start_ns ? event->begin_ns : trace_start_ns;
+      uint64_t end_ns = event->end_ns > begin_ns ? event->end_ns : begin_ns;
+
+      write_separator();
+      fprintf(trace_file,
+              "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+              event->name, ring->thread_id, (begin_ns - trace_start_ns) / 1000.0,
+              (end_ns - begin_ns) / 1000.0);
+    }
+
+    __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+  }
+
+  fflush(trace_file);
+}
+
+void trace_close(void) {
+  if (!trace_file)
+    return;
+
+  __atomic_store_n(&tracing, false, __ATOMIC_RELAXED);
+  trace_flush();
+  fputs("\n]\n", trace_file);
+  fclose(trace_file);
+  trace_file = NULL;
+}
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef BRICKGAME_CORE_TRACE_H
+#define BRICKGAME_CORE_TRACE_H
+
+// Span tracing that exports Chrome trace-event JSON (chrome://tracing,
+// ui.perfetto.dev). Built only with -DBRICK_TRACE (`make clean build
+// TRACE=1`); otherwise every TRACE_* macro expands to nothing.
+//
+// Each thread records into its own ring, so recording never takes a lock;
+// the thread that flushes drains every ring into the file. All threads
+// stamp spans with the same monotonic clock, so they line up on one
+// timeline.
+
+#ifdef BRICK_TRACE
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Must be a power of two.
+#define TRACE_RING_SIZE 16384
+
+typedef struct TraceEvent {
+  const char *name; // must outlive the trace, in practice a literal
+  uint64_t begin_ns;
+  uint64_t end_ns;
+} TraceEvent;
+
+typedef struct TraceScope {
+  const char *name;
+  uint64_t begin_ns;
+} TraceScope;
+
+uint64_t trace_now(void);
+
+// Names the calling thread in the trace.
+void trace_thread_name(const char *name);
+
+// Records a finished span on the calling thread. Spans are dropped while no
+// trace is open, or if the thread's ring is full.
+void trace_record(const char *name, uint64_t begin_ns, uint64_t end_ns);
+
+// Starts writing a trace to `path`. trace_flush and trace_close must be
+// called from one thread at a time.
+bool trace_open(const char *path);
+void trace_flush(void);
+void trace_close(void);
+
+static inline void trace_scope_end(TraceScope *scope) {
+  trace_record(scope->name, scope->begin_ns, trace_now());
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+// Records a span from here to the end of the enclosing block.
+#define TRACE_SCOPE(name)                                                                     \
+  TraceScope TRACE_CONCAT(trace_scope_, __LINE__)                                             \
+      __attribute__((cleanup(trace_scope_end))) = {name, trace_now()}
+#define TRACE_THREAD_NAME(name) trace_thread_name(name)
+#define TRACE_OPEN(path) trace_open(path)
+#define TRACE_FLUSH() trace_flush()
+#define TRACE_CLOSE() trace_close()
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#define TRACE_OPEN(path) (false)
+#define TRACE_FLUSH() ((void)0)
+#define TRACE_CLOSE() ((void)0)
+
+#endif
+
+#endif
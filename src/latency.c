@@ -0,0 +1,113 @@
+#include "latency.h"
+
+#include <SDL2/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *INPUT_NAMES[] = {
+    "none", "rotate", "left", "right", "down", "hard_drop", "pause", "gravity",
+};
+
+static uint32_t to_microseconds(const LatencyTracker *tracker, uint64_t from, uint64_t to) {
+  // The key timestamp comes from SDL's millisecond clock and can land a
+  // little after the moment it was converted against
+  if (to <= from)
+    return 0;
+
+  return (uint32_t)((to - from) * 1000000 / tracker->frequency);
+}
+
+bool latency_tracker_init(LatencyTracker *tracker, const char *csv_path) {
+  memset(tracker, 0, sizeof(LatencyTracker));
+  tracker->frequency = SDL_GetPerformanceFrequency();
+
+  if (csv_path) {
+    tracker->csv = fopen(csv_path, "w");
+    if (!tracker->csv)
+      return false;
+
+    fprintf(tracker->csv, "input,key_to_apply_us,apply_to_present_us,key_to_present_us\n");
+  }
+
+  return true;
+}
+
+void latency_tracker_destroy(LatencyTracker *tracker) {
+  if (tracker->csv)
+    fclose(tracker->csv);
+}
+
+void latency_tracker_collect(LatencyTracker *tracker, Simulation *simulation) {
+  InputTiming timing;
+
+  while (tracker->pending_count < LATENCY_PENDING_SIZE &&
+         simulation_next_timing(simulation, &timing))
+    tracker->pending[tracker->pending_count++] = timing;
+}
+
+void latency_tracker_presented(LatencyTracker *tracker, const Snapshot *snapshot, bool settled) {
+  // Nothing new is on screen yet
+  if (!settled)
+    return;
+
+  uint64_t presented_at = SDL_GetPerformanceCounter();
+  int kept = 0;
+
+  for (int i = 0; i < tracker->pending_count; i++) {
+    const InputTiming *timing = &tracker->pending[i];
+
+    // Not in this frame yet
+    if (snapshot->inputs_applied - timing->id <= 0) {
+      tracker->pending[kept++] = *timing;
+      continue;
+    }
+
+    uint32_t key_to_apply = to_microseconds(tracker, timing->sent_at, timing->applied_at);
+    uint32_t apply_to_present = to_microseconds(tracker, timing->applied_at, presented_at);
+    uint32_t key_to_present = to_microseconds(tracker, timing->sent_at, presented_at);
+
+    uint32_t slot = tracker->sample_count++ & (LATENCY_WINDOW - 1);
+    tracker->key_to_apply[slot] = key_to_apply;
+    tracker->key_to_present[slot] = key_to_present;
+    tracker->dirty = true;
+
+    if (tracker->csv)
+      fprintf(tracker->csv, "%s,%u,%u,%u\n", INPUT_NAMES[timing->input], key_to_apply,
+              apply_to_present, key_to_present);
+  }
+
+  tracker->pending_count = kept;
+}
+
+static int compare_samples(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void percentiles(const uint32_t *samples, int count, LatencyPercentiles *result) {
+  uint32_t sorted[LATENCY_WINDOW];
+
+  memcpy(sorted, samples, count * sizeof(uint32_t));
+  qsort(sorted, count, sizeof(uint32_t), compare_samples);
+
+  // Nearest rank, rounding down
+  result->p50 = sorted[(count - 1) * 50 / 100] / 1000.0f;
+  result->p95 = sorted[(count - 1) * 95 / 100] / 1000.0f;
+  result->p99 = sorted[(count - 1) * 99 / 100] / 1000.0f;
+}
+
+void latency_tracker_percentiles(LatencyTracker *tracker, LatencyPercentiles *apply,
+                                 LatencyPercentiles *present) {
+  // Samples only arrive with key presses, so this re-sorts rarely
+  if (tracker->dirty) {
+    int count = tracker->sample_count < LATENCY_WINDOW ? (int)tracker->sample_count
+                                                       : LATENCY_WINDOW;
+    percentiles(tracker->key_to_apply, count, &tracker->apply);
+    percentiles(tracker->key_to_present, count, &tracker->present);
+    tracker->dirty = false;
+  }
+
+  *apply = tracker->apply;
+  *present = tracker->present;
+}
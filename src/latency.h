@@ -0,0 +1,58 @@
+#ifndef BRICKGAME_LATENCY_H
+#define BRICKGAME_LATENCY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "simulation.h"
+
+// Percentiles are taken over the most recent samples. Must be a power of two.
+#define LATENCY_WINDOW 1024
+#define LATENCY_PENDING_SIZE 64
+
+typedef struct LatencyPercentiles {
+  float p50;
+  float p95;
+  float p99;
+} LatencyPercentiles;
+
+// Key-to-photon latency measurement. Each input the simulation applies comes
+// back with the time its key was pressed and the time it was applied. It
+// waits here until the first present of a frame that both was built from a
+// snapshot including it and drew the falling piece where that snapshot has
+// it, and that present completes the sample.
+typedef struct LatencyTracker {
+  uint64_t frequency;
+  FILE *csv;
+
+  InputTiming pending[LATENCY_PENDING_SIZE];
+  int pending_count;
+
+  // Microseconds, in a ring of the latest LATENCY_WINDOW samples
+  uint32_t key_to_apply[LATENCY_WINDOW];
+  uint32_t key_to_present[LATENCY_WINDOW];
+  uint64_t sample_count;
+
+  bool dirty;
+  LatencyPercentiles apply;
+  LatencyPercentiles present;
+} LatencyTracker;
+
+// `csv_path` receives one row per sample, or nothing if NULL.
+bool latency_tracker_init(LatencyTracker *tracker, const char *csv_path);
+void latency_tracker_destroy(LatencyTracker *tracker);
+
+// Picks up the timings the simulation has reported since the last call.
+void latency_tracker_collect(LatencyTracker *tracker, Simulation *simulation);
+
+// Call right after SDL_RenderPresent with the snapshot the frame was built
+// from. `settled` is false if the frame drew the falling piece part way
+// along a move, short of where the snapshot has it.
+void latency_tracker_presented(LatencyTracker *tracker, const Snapshot *snapshot, bool settled);
+
+// Key to applied and key to present percentiles, in milliseconds.
+void latency_tracker_percentiles(LatencyTracker *tracker, LatencyPercentiles *apply,
+                                 LatencyPercentiles *present);
+
+#endif
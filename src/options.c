@@ -0,0 +1,107 @@
+#include "options.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/replay.h"
+
+static void print_usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  --seed <n>        play the game that follows from this seed\n"
+          "  --tick-rate <hz>  simulation ticks per second (default 120)\n"
+          "  --no-vsync        don't wait for vblank when presenting\n"
+          "  --jit-input [us]  sample input as late as possible before each vblank,\n"
+          "                    leaving the given slack (default 1500)\n"
+          "  --latency [file]  measure key-to-present latency, show percentiles and\n"
+          "                    write every sample to a CSV file (default latency.csv)\n"
+          "  --trace [file]    record a Chrome trace (default trace.json), flushed\n"
+          "                    on exit and with F4; needs a TRACE=1 build\n"
+          "  --record <file>   record a replay of the game\n"
+          "  --replay <file>   watch a recorded replay instead of playing\n"
+          "  --fast            play the replay as fast as possible\n"
+          "  --render-bench [frames]\n"
+          "                    time the render path headlessly with the software\n"
+          "                    renderer (default 2000 frames) and exit\n",
+          program);
+}
+
+bool parse_options(Options *options, int argc, char *argv[]) {
+  options->seed = (uint64_t)time(NULL);
+  options->tick_rate = 120;
+  options->vsync = true;
+  options->jit_input = false;
+  options->jit_margin_us = 1500;
+  options->measure_latency = false;
+  options->latency_csv = "latency.csv";
+  options->trace_path = NULL;
+  options->record_path = NULL;
+  options->replay_path = NULL;
+  options->replay_fast = false;
+  options->render_bench_frames = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options->seed = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc) {
+      long tick_rate = strtol(argv[++i], NULL, 10);
+      if (tick_rate < REPLAY_MIN_TICK_RATE || tick_rate > REPLAY_MAX_TICK_RATE) {
+        fprintf(stderr, "Error: --tick-rate must be between %d and %d\n", REPLAY_MIN_TICK_RATE,
+                REPLAY_MAX_TICK_RATE);
+        return false;
+      }
+      options->tick_rate = (uint32_t)tick_rate;
+    } else if (strcmp(argv[i], "--no-vsync") == 0) {
+      options->vsync = false;
+    } else if (strcmp(argv[i], "--jit-input") == 0) {
+      options->jit_input = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        options->jit_margin_us = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--latency") == 0) {
+      options->measure_latency = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        options->latency_csv = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0) {
+#ifdef BRICK_TRACE
+      options->trace_path = "trace.json";
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        options->trace_path = argv[++i];
+#else
+      fprintf(stderr, "Error: --trace needs a build with TRACE=1\n");
+      return false;
+#endif
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      options->record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+      options->replay_path = argv[++i];
+    } else if (strcmp(argv[i], "--fast") == 0) {
+      options->replay_fast = true;
+    } else if (strcmp(argv[i], "--render-bench") == 0) {
+      options->render_bench_frames = 2000;
+      if (i + 1 < argc && argv[i + 1][0] != '-')
+        options->render_bench_frames = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else {
+      print_usage(argv[0]);
+      return false;
+    }
+  }
+
+  if (options->jit_input && !options->vsync) {
+    fprintf(stderr, "Error: --jit-input needs vsync to pace against\n");
+    return false;
+  }
+
+  if (options->record_path && options->replay_path) {
+    fprintf(stderr, "Error: --record and --replay can't be combined\n");
+    return false;
+  }
+
+  if (options->replay_fast && !options->replay_path) {
+    fprintf(stderr, "Error: --fast needs a --replay to play\n");
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef BRICKGAME_OPTIONS_H
+#define BRICKGAME_OPTIONS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Options {
+  uint64_t seed;            // picked from the clock unless given
+  uint32_t tick_rate; // simulation ticks per second
+  bool vsync;
+  bool jit_input;           // sample input just before the vblank
+  uint32_t jit_margin_us;   // slack left before the vblank in that mode
+  bool measure_latency;
+  const char *latency_csv;  // where latency samples go in that mode
+  const char *trace_path;   // Chrome trace output, or NULL
+  const char *record_path;  // replay output, or NULL
+  const char *replay_path;  // replay to play back instead of playing, or NULL
+  bool replay_fast;         // play it back as fast as possible
+  uint32_t render_bench_frames; // run the headless render benchmark instead
+} Options;
+
+// Fills `options` from the command line. Prints usage and returns false on
+// anything it doesn't understand.
+bool parse_options(Options *options, int argc, char *argv[]);
+
+#endif
@@ -0,0 +1,50 @@
+#include "pacing.h"
+
+#include <SDL2/SDL.h>
+
+void frame_pacer_init(FramePacer *pacer, int refresh_rate, uint32_t margin_us) {
+  pacer->frequency = SDL_GetPerformanceFrequency();
+  pacer->refresh_period = pacer->frequency / (uint64_t)(refresh_rate > 0 ? refresh_rate : 60);
+  pacer->margin = pacer->frequency * margin_us / 1000000;
+  pacer->build_estimate = pacer->refresh_period / 4;
+  pacer->build_started = 0;
+  pacer->last_present = SDL_GetPerformanceCounter();
+}
+
+void frame_pacer_wait(FramePacer *pacer) {
+  uint64_t reserved = pacer->build_estimate + pacer->margin;
+  if (reserved >= pacer->refresh_period)
+    return;
+
+  uint64_t wake_at = pacer->last_present + pacer->refresh_period - reserved;
+  uint64_t now = SDL_GetPerformanceCounter();
+
+  // SDL_Delay only has millisecond resolution and may oversleep, so sleep
+  // to within a millisecond and spin the rest
+  uint64_t millisecond = pacer->frequency / 1000;
+  if (wake_at > now + 2 * millisecond)
+    SDL_Delay((uint32_t)((wake_at - now) / millisecond) - 1);
+
+  while (SDL_GetPerformanceCounter() < wake_at)
+    ;
+}
+
+void frame_pacer_begin_frame(FramePacer *pacer) {
+  pacer->build_started = SDL_GetPerformanceCounter();
+}
+
+void frame_pacer_end_frame(FramePacer *pacer) {
+  uint64_t build = SDL_GetPerformanceCounter() - pacer->build_started;
+
+  // A slowly decaying peak: one slow frame raises the estimate at once, and
+  // it takes a while of fast frames to lower it again
+  pacer->build_estimate -= pacer->build_estimate / 32;
+  if (build > pacer->build_estimate)
+    pacer->build_estimate = build;
+}
+
+void frame_pacer_presented(FramePacer *pacer) {
+  // With vsync SDL_RenderPresent returns at the vblank it waited for, which
+  // is where the next frame's deadline is counted from
+  pacer->last_present = SDL_GetPerformanceCounter();
+}
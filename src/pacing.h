@@ -0,0 +1,33 @@
+#ifndef BRICKGAME_PACING_H
+#define BRICKGAME_PACING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Just-in-time frame pacing. With vsync, a frame built right after the
+// previous present sits finished for most of a refresh interval, showing
+// input that was sampled that long ago. The pacer instead sleeps until just
+// enough time is left to build the frame before the next vblank, so input is
+// sampled as late as possible.
+typedef struct FramePacer {
+  uint64_t frequency;
+  uint64_t refresh_period;  // performance counter ticks per vblank
+  uint64_t margin;          // slack left on top of the build estimate
+  uint64_t build_estimate;  // decaying peak of recent frame build times
+  uint64_t build_started;
+  uint64_t last_present;
+} FramePacer;
+
+void frame_pacer_init(FramePacer *pacer, int refresh_rate, uint32_t margin_us);
+
+// Sleeps until it's time to sample input and build the next frame.
+void frame_pacer_wait(FramePacer *pacer);
+
+// Called around building a frame (from sampling input up to, not including,
+// SDL_RenderPresent) and right after the present returns, to learn how long
+// a frame takes and where the vblank is.
+void frame_pacer_begin_frame(FramePacer *pacer);
+void frame_pacer_end_frame(FramePacer *pacer);
+void frame_pacer_presented(FramePacer *pacer);
+
+#endif
@@ -0,0 +1,172 @@
+#include "profiler.h"
+
+#ifdef BRICK_PROFILER
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERCENTILE_INTERVAL 16
+#define GRAPH_SCALE 4 // pixels per millisecond
+#define GRAPH_HEIGHT (GRAPH_SCALE * 34)
+
+Profiler frame_profiler;
+
+static const char *PHASE_NAMES[PHASE_COUNT] = {
+    [PHASE_EVENTS] = "events",  [PHASE_SIMULATION] = "sim",  [PHASE_BOARD] = "board",
+    [PHASE_PIECES] = "pieces", [PHASE_TEXT] = "text",       [PHASE_HUD] = "hud",
+    [PHASE_PRESENT] = "present",
+};
+
+static const SDL_Color PHASE_COLORS[PHASE_COUNT] = {
+    [PHASE_EVENTS] = {0x22, 0xB8, 0xCF, 255}, [PHASE_SIMULATION] = {0xFC, 0xC4, 0x19, 255},
+    [PHASE_BOARD] = {0x51, 0xCF, 0x66, 255},  [PHASE_PIECES] = {0xF0, 0x65, 0x95, 255},
+    [PHASE_TEXT] = {0x33, 0x9A, 0xF0, 255},   [PHASE_HUD] = {0x86, 0x8E, 0x96, 255},
+    [PHASE_PRESENT] = {0xFF, 0x92, 0x2B, 255},
+};
+
+static const SDL_Color HUD_TEXT_COLOR = {0xF8, 0xF9, 0xFA, 255};
+static const SDL_Color HUD_BACKGROUND = {0x00, 0x00, 0x00, 192};
+
+void profiler_init(Profiler *profiler) {
+  memset(profiler, 0, sizeof(Profiler));
+  profiler->frequency = SDL_GetPerformanceFrequency();
+  profiler->phase = -1;
+}
+
+void profiler_phase(Profiler *profiler, enum ProfilePhase phase) {
+  uint64_t now = SDL_GetPerformanceCounter();
+
+  if (profiler->phase >= 0)
+    profiler->current.phase_ticks[profiler->phase] += now - profiler->phase_started;
+
+  profiler->phase = phase;
+  profiler->phase_started = now;
+}
+
+static int compare_floats(const void *a, const void *b) {
+  float x = *(const float *)a;
+  float y = *(const float *)b;
+  return (x > y) - (x < y);
+}
+
+static void percentiles(const float *samples, int count, float *p50, float *p99) {
+  float sorted[PROFILER_HISTORY];
+
+  memcpy(sorted, samples, count * sizeof(float));
+  qsort(sorted, count, sizeof(float), compare_floats);
+
+  *p50 = sorted[(count - 1) * 50 / 100];
+  *p99 = sorted[(count - 1) * 99 / 100];
+}
+
+void profiler_end_frame(Profiler *profiler) {
+  uint64_t now = SDL_GetPerformanceCounter();
+
+  if (profiler->phase >= 0)
+    profiler->current.phase_ticks[profiler->phase] += now - profiler->phase_started;
+  profiler->phase = -1;
+
+  uint32_t slot = profiler->frame_count++ & (PROFILER_HISTORY - 1);
+  float frame = 0;
+
+  for (int phase = 0; phase < PHASE_COUNT; phase++) {
+    float ms = profiler->current.phase_ticks[phase] * 1000.0f / profiler->frequency;
+    profiler->phase_history[phase][slot] = ms;
+    frame += ms;
+  }
+
+  profiler->frame_history[slot] = frame;
+  profiler->draw_call_history[slot] = profiler->current.draw_calls;
+  profiler->color_change_history[slot] = profiler->current.color_changes;
+  memset(&profiler->current, 0, sizeof(FrameProfile));
+
+  if (!profiler->visible || profiler->frame_count % PERCENTILE_INTERVAL)
+    return;
+
+  int count = profiler->frame_count < PROFILER_HISTORY ? (int)profiler->frame_count
+                                                       : PROFILER_HISTORY;
+  for (int phase = 0; phase < PHASE_COUNT; phase++)
+    percentiles(profiler->phase_history[phase], count, &profiler->p50[phase],
+                &profiler->p99[phase]);
+  percentiles(profiler->frame_history, count, &profiler->p50[PHASE_COUNT],
+              &profiler->p99[PHASE_COUNT]);
+}
+
+// Frame times as stacked bars, oldest on the left, with a line at 60 Hz.
+static void render_graph(Profiler *profiler, SDL_Renderer *renderer, int x, int y) {
+  SDL_Rect bars[PROFILER_HISTORY];
+  float stacked[PROFILER_HISTORY] = {0};
+  int draw_calls = 0;
+
+  for (int phase = 0; phase < PHASE_COUNT; phase++) {
+    for (int i = 0; i < PROFILER_HISTORY; i++) {
+      uint32_t slot = (profiler->frame_count + i) & (PROFILER_HISTORY - 1);
+      float ms = profiler->phase_history[phase][slot];
+
+      int top = (int)((stacked[i] + ms) * GRAPH_SCALE);
+      int bottom = (int)(stacked[i] * GRAPH_SCALE);
+      if (top > GRAPH_HEIGHT)
+        top = GRAPH_HEIGHT;
+
+      bars[i].x = x + i;
+      bars[i].y = y + GRAPH_HEIGHT - top;
+      bars[i].w = 1;
+      bars[i].h = top > bottom ? top - bottom : 0;
+      stacked[i] += ms;
+    }
+
+    SDL_Color color = PHASE_COLORS[phase];
+    SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+    SDL_RenderFillRects(renderer, bars, PROFILER_HISTORY);
+    draw_calls++;
+  }
+
+  SDL_Rect vsync_line = {x, y + GRAPH_HEIGHT - (int)(16.67f * GRAPH_SCALE), PROFILER_HISTORY, 1};
+  SDL_SetRenderDrawColor(renderer, 0xFF, 0x6B, 0x6B, 255);
+  SDL_RenderFillRect(renderer, &vsync_line);
+
+  PROFILE_DRAW_CALLS(draw_calls + 1);
+  PROFILE_COLOR_CHANGES(draw_calls + 1);
+}
+
+void profiler_render(Profiler *profiler, SDL_Renderer *renderer, GlyphAtlas *atlas) {
+  int line_height = atlas->line_height;
+  SDL_Rect panel = {0, line_height + 10, PROFILER_HISTORY + 20,
+                    GRAPH_HEIGHT + (PHASE_COUNT + 2) * line_height + 30};
+
+  SDL_BlendMode blend_mode;
+  SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+  SDL_SetRenderDrawColor(renderer, HUD_BACKGROUND.r, HUD_BACKGROUND.g, HUD_BACKGROUND.b,
+                         HUD_BACKGROUND.a);
+  SDL_RenderFillRect(renderer, &panel);
+  PROFILE_DRAW_CALLS(1);
+  PROFILE_COLOR_CHANGES(1);
+
+  render_graph(profiler, renderer, panel.x + 10, panel.y + 10);
+  SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+
+  // Counts are from the last complete frame, the current one is still going
+  uint32_t last = (profiler->frame_count - 1) & (PROFILER_HISTORY - 1);
+  int y = panel.y + GRAPH_HEIGHT + 20;
+  char text[64];
+
+  snprintf(text, sizeof(text), "frame %.2f / %.2f ms", profiler->p50[PHASE_COUNT],
+           profiler->p99[PHASE_COUNT]);
+  render_text(renderer, atlas, panel.x + 10, y, text, HUD_TEXT_COLOR);
+  y += line_height;
+
+  for (int phase = 0; phase < PHASE_COUNT; phase++) {
+    snprintf(text, sizeof(text), "%s %.2f / %.2f", PHASE_NAMES[phase], profiler->p50[phase],
+             profiler->p99[phase]);
+    render_text(renderer, atlas, panel.x + 10, y, text, PHASE_COLORS[phase]);
+    y += line_height;
+  }
+
+  snprintf(text, sizeof(text), "draws %u  colors %u", profiler->draw_call_history[last],
+           profiler->color_change_history[last]);
+  render_text(renderer, atlas, panel.x + 10, y, text, HUD_TEXT_COLOR);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef BRICKGAME_PROFILER_H
+#define BRICKGAME_PROFILER_H
+
+// Frame-time profiler with an in-game HUD (toggled with F3). Built only with
+// -DBRICK_PROFILER (`make clean build PROFILER=1`); otherwise every PROFILE_* macro
+// expands to nothing and none of this is compiled.
+
+#ifdef BRICK_PROFILER
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "text.h"
+
+// Must be a power of two.
+#define PROFILER_HISTORY 256
+
+enum ProfilePhase {
+  PHASE_EVENTS,
+  PHASE_SIMULATION, // waiting for the simulation to catch up with input
+  PHASE_BOARD,
+  PHASE_PIECES,     // falling piece and ghost
+  PHASE_TEXT,
+  PHASE_HUD,
+  PHASE_PRESENT,
+  PHASE_COUNT,
+};
+
+typedef struct FrameProfile {
+  uint64_t phase_ticks[PHASE_COUNT];
+  uint32_t draw_calls;
+  uint32_t color_changes;
+} FrameProfile;
+
+typedef struct Profiler {
+  bool visible;
+  uint64_t frequency;
+
+  FrameProfile current;
+  int phase;
+  uint64_t phase_started;
+
+  // The last PROFILER_HISTORY frames, in milliseconds
+  float phase_history[PHASE_COUNT][PROFILER_HISTORY];
+  float frame_history[PROFILER_HISTORY];
+  uint32_t draw_call_history[PROFILER_HISTORY];
+  uint32_t color_change_history[PROFILER_HISTORY];
+  uint64_t frame_count;
+
+  // Percentiles are recomputed every few frames rather than every frame
+  float p50[PHASE_COUNT + 1];
+  float p99[PHASE_COUNT + 1];
+} Profiler;
+
+// One per process: draw calls are counted from deep inside the renderers.
+extern Profiler frame_profiler;
+
+void profiler_init(Profiler *profiler);
+
+// Ends the running phase, if any, and starts `phase`.
+void profiler_phase(Profiler *profiler, enum ProfilePhase phase);
+
+// Ends the running phase and files the frame into the history.
+void profiler_end_frame(Profiler *profiler);
+
+void profiler_render(Profiler *profiler, SDL_Renderer *renderer, GlyphAtlas *atlas);
+
+#define PROFILE_INIT() profiler_init(&frame_profiler)
+#define PROFILE_PHASE(phase) profiler_phase(&frame_profiler, phase)
+#define PROFILE_END_FRAME() profiler_end_frame(&frame_profiler)
+#define PROFILE_DRAW_CALLS(count) (frame_profiler.current.draw_calls += (count))
+#define PROFILE_COLOR_CHANGES(count) (frame_profiler.current.color_changes += (count))
+#define PROFILE_TOGGLE() (frame_profiler.visible = !frame_profiler.visible)
+#define PROFILE_RENDER(renderer, atlas)                                                       \
+  do {                                                                                        \
+    if (frame_profiler.visible)                                                               \
+      profiler_render(&frame_profiler, renderer, atlas);                                      \
+  } while (0)
+
+#else
+
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_PHASE(phase) ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#define PROFILE_DRAW_CALLS(count) ((void)0)
+#define PROFILE_COLOR_CHANGES(count) ((void)0)
+#define PROFILE_TOGGLE() ((void)0)
+#define PROFILE_RENDER(renderer, atlas) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,283 @@
+#include "render.h"
+
+#include "core/trace.h"
+#include "profiler.h"
+
+static const SDL_Color TILE_FILL[TILE_COLOR_COUNT] = {
+  [LIGHT_BLUE] = {0x22, 0xB8, 0xCF, 255},
+  [YELLOW] = {0xFC, 0xC4, 0x19, 255},
+  [PINK] = {0xF0, 0x65, 0x95, 255},
+  [BLUE] = {0x33, 0x9A, 0xF0, 255},
+  [ORANGE] = {0xFF, 0x92, 0x2B, 255},
+  [GREEN] = {0x51, 0xCF, 0x66, 255},
+  [RED] = {0xFF, 0x6B, 0x6B, 255},
+  [GARBAGE] = {0x86, 0x8E, 0x96, 255},
+};
+
+static const SDL_Color TILE_OUTLINE[TILE_COLOR_COUNT] = {
+  [LIGHT_BLUE] = {0x10, 0x98, 0xAD, 255},
+  [YELLOW] = {0xF5, 0x9F, 0x00, 255},
+  [PINK] = {0xD6, 0x33, 0x6C, 255},
+  [BLUE] = {0x1C, 0x7E, 0xE6, 255},
+  [ORANGE] = {0xF7, 0x67, 0x07, 255},
+  [GREEN] = {0x37, 0xB2, 0x4D, 255},
+  [RED] = {0xF0, 0x3E, 0x3E, 255},
+  [GARBAGE] = {0x6A, 0x72, 0x7A, 255},
+};
+
+TileBatch *tile_batch_create() {
+  TileBatch *batch = (TileBatch *)SDL_calloc(1, sizeof(TileBatch));
+
+  if (batch)
+    batch->use_geometry = true;
+
+  return batch;
+}
+
+void tile_batch_destroy(TileBatch *batch) {
+  SDL_free(batch);
+}
+
+void tile_batch_begin(TileBatch *batch, SDL_Rect board_rect, SDL_Rect tile_rect,
+                      const SDL_Color *background_color) {
+  batch->board_rect = board_rect;
+  batch->tile_rect = tile_rect;
+  batch->has_background = background_color != NULL;
+  if (background_color)
+    batch->background_color = *background_color;
+  batch->tile_count = 0;
+}
+
+void tile_batch_add_tile(TileBatch *batch, float x, float y, enum TileColor tile_color,
+                         uint8_t opacity) {
+  if (batch->tile_count == TILE_BATCH_CAPACITY)
+    return;
+
+  BatchedTile *tile = &batch->tiles[batch->tile_count++];
+
+  tile->outline.x = batch->board_rect.x + (int)SDL_floorf(batch->tile_rect.w * x + 0.5f);
+  tile->outline.y = batch->board_rect.y + (int)SDL_floorf(batch->tile_rect.h * y + 0.5f);
+  tile->outline.w = batch->tile_rect.w;
+  tile->outline.h = batch->tile_rect.h;
+
+  tile->fill = tile->outline;
+  tile->fill.x += tile->outline.w / 8;
+  tile->fill.y += tile->outline.h / 8;
+  tile->fill.w -= tile->outline.w / 4;
+  tile->fill.h -= tile->outline.h / 4;
+
+  tile->color = tile_color;
+  tile->opacity = opacity;
+}
+
+void tile_batch_add_piece(TileBatch *batch, float x, float y, Piece piece, uint8_t opacity) {
+  for (int ty = 0; ty < 4; ty++) {
+    uint8_t row = piece.repr_cache[ty];
+    for (int tx = 0; tx < 4; tx++) {
+      if (row & (0b10000000 >> tx)) {
+        tile_batch_add_tile(batch, tx + x, ty + y, (enum TileColor)piece.type, opacity);
+      }
+    }
+  }
+}
+
+void tile_batch_add_board(TileBatch *batch, const GameState *state) {
+  for (int y = 0; y < 16; y++) {
+    if (!state->board[y])
+      continue;
+
+    for (int x = 0; x < 8; x++) {
+      if (state->board[y] & (0b10000000 >> x))
+        tile_batch_add_tile(batch, (float)x, (float)y, tile_color(state, x, y), 255);
+    }
+  }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+
+static void add_quad(TileBatch *batch, int quad, SDL_Rect rect, SDL_Color color) {
+  SDL_Vertex *vertices = &batch->vertices[quad * 4];
+  int *indices = &batch->indices[quad * 6];
+  float x0 = (float)rect.x;
+  float y0 = (float)rect.y;
+  float x1 = (float)(rect.x + rect.w);
+  float y1 = (float)(rect.y + rect.h);
+
+  for (int i = 0; i < 4; i++) {
+    vertices[i].color = color;
+    vertices[i].tex_coord.x = 0;
+    vertices[i].tex_coord.y = 0;
+  }
+
+  vertices[0].position.x = x0;
+  vertices[0].position.y = y0;
+  vertices[1].position.x = x1;
+  vertices[1].position.y = y0;
+  vertices[2].position.x = x1;
+  vertices[2].position.y = y1;
+  vertices[3].position.x = x0;
+  vertices[3].position.y = y1;
+
+  indices[0] = quad * 4;
+  indices[1] = quad * 4 + 1;
+  indices[2] = quad * 4 + 2;
+  indices[3] = quad * 4;
+  indices[4] = quad * 4 + 2;
+  indices[5] = quad * 4 + 3;
+}
+
+static bool flush_geometry(TileBatch *batch, SDL_Renderer *renderer) {
+  if (!batch->has_background && !batch->tile_count)
+    return true;
+
+  int quads = 0;
+
+  if (batch->has_background)
+    add_quad(batch, quads++, batch->board_rect, batch->background_color);
+
+  for (int i = 0; i < batch->tile_count; i++) {
+    const BatchedTile *tile = &batch->tiles[i];
+    SDL_Color outline = TILE_OUTLINE[tile->color];
+    SDL_Color fill = TILE_FILL[tile->color];
+
+    outline.a = tile->opacity;
+    fill.a = tile->opacity;
+
+    add_quad(batch, quads++, tile->outline, outline);
+    add_quad(batch, quads++, tile->fill, fill);
+  }
+
+  return SDL_RenderGeometry(renderer, NULL, batch->vertices, quads * 4, batch->indices,
+                            quads * 6) == 0;
+}
+
+#endif
+
+// Tiles never overlap each other except for the ghost, so drawing all outlines
+// of a color and then all fills of it gives the same picture as going tile by
+// tile, as long as the translucent ones come last.
+static int flush_rects(TileBatch *batch, SDL_Renderer *renderer) {
+  int draw_calls = 0;
+
+  if (batch->has_background) {
+    SDL_SetRenderDrawColor(renderer, batch->background_color.r, batch->background_color.g,
+                           batch->background_color.b, batch->background_color.a);
+    SDL_RenderFillRect(renderer, &batch->board_rect);
+    draw_calls++;
+  }
+
+  for (int pass = 0; pass < 2; pass++) {
+    bool translucent = pass == 1;
+
+    for (int layer = 0; layer < 2; layer++) {
+      for (int color = 0; color < TILE_COLOR_COUNT; color++) {
+        int count = 0;
+        uint8_t opacity = 255;
+
+        for (int i = 0; i < batch->tile_count; i++) {
+          const BatchedTile *tile = &batch->tiles[i];
+
+          if (tile->color != color || (tile->opacity < 255) != translucent)
+            continue;
+
+          batch->rects[count++] = layer == 0 ? tile->outline : tile->fill;
+          opacity = tile->opacity;
+        }
+
+        if (!count)
+          continue;
+
+        SDL_Color draw_color = layer == 0 ? TILE_OUTLINE[color] : TILE_FILL[color];
+        SDL_SetRenderDrawColor(renderer, draw_color.r, draw_color.g, draw_color.b, opacity);
+        SDL_RenderFillRects(renderer, batch->rects, count);
+        draw_calls++;
+      }
+    }
+  }
+
+  // Every fill comes with its own color
+  PROFILE_COLOR_CHANGES(draw_calls);
+
+  return draw_calls;
+}
+
+int tile_batch_flush(TileBatch *batch, SDL_Renderer *renderer) {
+  TRACE_SCOPE("tile_batch_flush");
+
+  SDL_BlendMode blend_mode;
+  int draw_calls = 1;
+
+  SDL_GetRenderDrawBlendMode(renderer, &blend_mode);
+  SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (!batch->use_geometry || !flush_geometry(batch, renderer)) {
+    batch->use_geometry = false;
+    draw_calls = flush_rects(batch, renderer);
+  }
+#else
+  draw_calls = flush_rects(batch, renderer);
+#endif
+
+  SDL_SetRenderDrawBlendMode(renderer, blend_mode);
+  batch->tile_count = 0;
+  PROFILE_DRAW_CALLS(draw_calls);
+
+  return draw_calls;
+}
+
+void board_layer_init(BoardLayer *layer) {
+  SDL_memset(layer, 0, sizeof(BoardLayer));
+}
+
+void board_layer_destroy(BoardLayer *layer) {
+  if (layer->texture)
+    SDL_DestroyTexture(layer->texture);
+  board_layer_init(layer);
+}
+
+void board_layer_invalidate(BoardLayer *layer) {
+  layer->valid = false;
+}
+
+bool board_layer_update(BoardLayer *layer, SDL_Renderer *renderer, TileBatch *batch,
+                        const GameState *state, SDL_Rect tile_rect, SDL_Color background_color) {
+  TRACE_SCOPE("board_layer_update");
+
+  if (!SDL_RenderTargetSupported(renderer))
+    return false;
+
+  if (layer->texture &&
+      (layer->tile_rect.w != tile_rect.w || layer->tile_rect.h != tile_rect.h))
+    board_layer_destroy(layer);
+
+  if (!layer->texture) {
+    layer->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                                       SDL_TEXTUREACCESS_TARGET, tile_rect.w * 8,
+                                       tile_rect.h * 16);
+    if (!layer->texture)
+      return false;
+
+    layer->tile_rect = tile_rect;
+    layer->valid = false;
+  }
+
+  if (layer->valid && layer->revision == state->board_revision)
+    return true;
+
+  SDL_Texture *previous_target = SDL_GetRenderTarget(renderer);
+  if (SDL_SetRenderTarget(renderer, layer->texture) < 0)
+    return false;
+
+  SDL_Rect layer_rect = {0, 0, tile_rect.w * 8, tile_rect.h * 16};
+  tile_batch_begin(batch, layer_rect, tile_rect, &background_color);
+  tile_batch_add_board(batch, state);
+  tile_batch_flush(batch, renderer);
+
+  SDL_SetRenderTarget(renderer, previous_target);
+
+  layer->revision = state->board_revision;
+  layer->valid = true;
+
+  return true;
+}
@@ -0,0 +1,75 @@
+#ifndef BRICKGAME_RENDER_H
+#define BRICKGAME_RENDER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/game.h"
+
+// Enough for the background, a full board, the falling piece and its ghost.
+#define TILE_BATCH_CAPACITY (16 * 8 + 4 + 4)
+
+typedef struct BatchedTile {
+  SDL_Rect outline;
+  SDL_Rect fill;
+  enum TileColor color;
+  uint8_t opacity;
+} BatchedTile;
+
+// Collects everything drawn on the board during a frame so it can be
+// submitted at once: one SDL_RenderGeometry call, or, on renderers without
+// geometry support, one SDL_RenderFillRects call per color.
+typedef struct TileBatch {
+  SDL_Rect board_rect;
+  SDL_Rect tile_rect;
+
+  bool has_background;
+  SDL_Color background_color;
+  BatchedTile tiles[TILE_BATCH_CAPACITY];
+  int tile_count;
+
+  bool use_geometry;
+  SDL_Vertex vertices[(TILE_BATCH_CAPACITY * 2 + 1) * 4];
+  int indices[(TILE_BATCH_CAPACITY * 2 + 1) * 6];
+  SDL_Rect rects[TILE_BATCH_CAPACITY];
+} TileBatch;
+
+TileBatch *tile_batch_create();
+void tile_batch_destroy(TileBatch *batch);
+
+// `background_color` fills the board behind the tiles, or nothing if NULL.
+void tile_batch_begin(TileBatch *batch, SDL_Rect board_rect, SDL_Rect tile_rect,
+                      const SDL_Color *background_color);
+// Positions are in tiles and may be fractional, for interpolated motion.
+void tile_batch_add_tile(TileBatch *batch, float x, float y, enum TileColor tile_color,
+                         uint8_t opacity);
+void tile_batch_add_piece(TileBatch *batch, float x, float y, Piece piece, uint8_t opacity);
+void tile_batch_add_board(TileBatch *batch, const GameState *state);
+
+// Draws everything collected since tile_batch_begin and returns the number
+// of draw calls it took.
+int tile_batch_flush(TileBatch *batch, SDL_Renderer *renderer);
+
+// The locked stack rendered into a texture, redrawn only when the game's
+// board_revision moves on, so a frame just copies it and adds the falling
+// piece and the ghost on top.
+typedef struct BoardLayer {
+  SDL_Texture *texture;
+  SDL_Rect tile_rect;
+  uint32_t revision;
+  bool valid;
+} BoardLayer;
+
+void board_layer_init(BoardLayer *layer);
+void board_layer_destroy(BoardLayer *layer);
+
+// Forces a redraw, e.g. after SDL_RENDER_TARGETS_RESET.
+void board_layer_invalidate(BoardLayer *layer);
+
+// Brings the layer up to date with `state`. Returns false if the renderer
+// can't render to textures, in which case the board has to be drawn directly.
+bool board_layer_update(BoardLayer *layer, SDL_Renderer *renderer, TileBatch *batch,
+                        const GameState *state, SDL_Rect tile_rect, SDL_Color background_color);
+
+#endif
@@ -0,0 +1,207 @@
+#include "render_bench.h"
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "core/replay.h"
+#include "scene.h"
+
+#define SCRIPT_LENGTH 1024
+#define BENCH_WIDTH 480
+#define BENCH_HEIGHT 800
+
+enum BenchPhase {
+  BENCH_BOARD,
+  BENCH_PIECES,
+  BENCH_TEXT,
+  BENCH_PRESENT,
+  BENCH_PHASE_COUNT,
+};
+
+static const char *BENCH_PHASE_NAMES[BENCH_PHASE_COUNT] = {
+    [BENCH_BOARD] = "board (tiles)",
+    [BENCH_PIECES] = "pieces (ghost)",
+    [BENCH_TEXT] = "text",
+    [BENCH_PRESENT] = "present",
+};
+
+// A fixed game to draw: every piece is turned and shifted at random, eased
+// down a few rows and then dropped, with the state kept after each step so
+// the frames see pieces move, lock and clear lines like in play.
+static void record_script(GameState *script) {
+  static const enum GameInput MOVES[] = {INPUT_ROTATE, INPUT_LEFT, INPUT_RIGHT, INPUT_DOWN};
+
+  Rng rng;
+  rng_seed(&rng, 1);
+
+  GameState state;
+  game_init(&state, rng_next(&rng));
+
+  for (int i = 0; i < SCRIPT_LENGTH; i++) {
+    if (state.game_over)
+      game_init(&state, rng_next(&rng));
+
+    step(&state, i % 8 == 7 ? INPUT_HARD_DROP : MOVES[rng_below(&rng, 4)]);
+    script[i] = state;
+  }
+}
+
+// The same, but following a recorded game step by step, starting over
+// whenever it ends. Returns false if the replay can't be read or has no
+// steps.
+static bool replay_script(GameState *script, const uint8_t *data, size_t size) {
+  ReplayReader reader;
+  if (!replay_reader_init(&reader, data, size))
+    return false;
+  size_t start = reader.offset;
+
+  GameState state;
+  game_init(&state, reader.header.seed);
+
+  for (int i = 0; i < SCRIPT_LENGTH; i++) {
+    uint64_t tick;
+    enum GameInput input;
+
+    if (replay_next(&reader, &tick, &input) != REPLAY_RECORD_EVENT) {
+      if (i == 0)
+        return false;
+
+      reader.offset = start;
+      reader.tick = 0;
+      game_init(&state, reader.header.seed);
+      if (replay_next(&reader, &tick, &input) != REPLAY_RECORD_EVENT)
+        return false;
+    }
+
+    step(&state, input);
+    script[i] = state;
+  }
+
+  return true;
+}
+
+static int compare_ticks(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static uint64_t percentile(uint64_t *samples, uint32_t count, int percent) {
+  qsort(samples, count, sizeof(uint64_t), compare_ticks);
+  return samples[(count - 1) * percent / 100];
+}
+
+int run_render_bench(uint32_t frames, const char *replay_path) {
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+
+  if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    fprintf(stderr, "Error: Couldn't initialize SDL2: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  SDL_Window *window = SDL_CreateWindow("BrickGame", 0, 0, BENCH_WIDTH, BENCH_HEIGHT,
+                                        SDL_WINDOW_HIDDEN);
+  SDL_Renderer *renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : NULL;
+  if (!renderer) {
+    fprintf(stderr, "Error: Couldn't create a software renderer: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+
+  TTF_Init();
+  Scene scene;
+  if (!scene_init(&scene, renderer, "res/Roboto-Regular.ttf")) {
+    fprintf(stderr, "Error: Couldn't set up rendering: %s\n", SDL_GetError());
+    return EXIT_FAILURE;
+  }
+  scene_layout(&scene, BENCH_WIDTH, BENCH_HEIGHT);
+
+  GameState *script = game_alloc(SCRIPT_LENGTH);
+  uint64_t *samples = (uint64_t *)malloc(sizeof(uint64_t) * frames * BENCH_PHASE_COUNT);
+  uint64_t *phase_samples = (uint64_t *)malloc(sizeof(uint64_t) * frames);
+  if (!script || !samples || !phase_samples) {
+    fprintf(stderr, "Error: Couldn't allocate the benchmark\n");
+    return EXIT_FAILURE;
+  }
+
+  if (replay_path) {
+    size_t size;
+    void *replay = SDL_LoadFile(replay_path, &size);
+    bool loaded = replay && replay_script(script, (const uint8_t *)replay, size);
+    SDL_free(replay);
+
+    if (!loaded) {
+      fprintf(stderr, "Error: Couldn't play %s\n", replay_path);
+      return EXIT_FAILURE;
+    }
+  } else {
+    record_script(script);
+  }
+
+  uint64_t frequency = SDL_GetPerformanceFrequency();
+  uint64_t bench_start = SDL_GetPerformanceCounter();
+
+  // SDL batches draw calls until it has to flush them, which would bill the
+  // actual drawing to whichever phase happened to flush. Flushing at the end
+  // of every phase keeps each phase's cost with it.
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    const GameState *game = &script[frame % SCRIPT_LENGTH];
+    uint64_t *frame_samples = &samples[frame * BENCH_PHASE_COUNT];
+    uint64_t start = SDL_GetPerformanceCounter();
+    uint64_t end;
+
+    scene_draw_board(&scene, game);
+    SDL_RenderFlush(renderer);
+    end = SDL_GetPerformanceCounter();
+    frame_samples[BENCH_BOARD] = end - start;
+    start = end;
+
+    scene_draw_pieces(&scene, game, (float)game->falling_piece_x, (float)game->falling_piece_y);
+    SDL_RenderFlush(renderer);
+    end = SDL_GetPerformanceCounter();
+    frame_samples[BENCH_PIECES] = end - start;
+    start = end;
+
+    scene_draw_text(&scene, game);
+    SDL_RenderFlush(renderer);
+    end = SDL_GetPerformanceCounter();
+    frame_samples[BENCH_TEXT] = end - start;
+    start = end;
+
+    SDL_RenderPresent(renderer);
+    end = SDL_GetPerformanceCounter();
+    frame_samples[BENCH_PRESENT] = end - start;
+  }
+
+  double seconds = (double)(SDL_GetPerformanceCounter() - bench_start) / frequency;
+
+  SDL_RendererInfo info;
+  SDL_GetRendererInfo(renderer, &info);
+  printf("%u frames on %s/%s in %.3f s: %.1f fps\n", frames, SDL_GetCurrentVideoDriver(),
+         info.name, seconds, frames / seconds);
+
+  // Regroup by phase so each one can be sorted on its own
+  for (int phase = 0; phase < BENCH_PHASE_COUNT; phase++) {
+    uint64_t total = 0;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      phase_samples[frame] = samples[frame * BENCH_PHASE_COUNT + phase];
+      total += phase_samples[frame];
+    }
+
+    printf("%-16s %9.1f us mean %9.1f us p50 %9.1f us p99\n", BENCH_PHASE_NAMES[phase],
+           total * 1e6 / frequency / frames, percentile(phase_samples, frames, 50) * 1e6 / frequency,
+           percentile(phase_samples, frames, 99) * 1e6 / frequency);
+  }
+
+  free(phase_samples);
+  free(samples);
+  game_free(script);
+  scene_destroy(&scene);
+  SDL_DestroyRenderer(renderer);
+  SDL_DestroyWindow(window);
+  SDL_Quit();
+  TTF_Quit();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,14 @@
+#ifndef BRICKGAME_RENDER_BENCH_H
+#define BRICKGAME_RENDER_BENCH_H
+
+#include <stdint.h>
+
+// Draws `frames` frames of a scripted game through the normal scene code on
+// SDL's software renderer, with no window on screen, and prints the frame
+// rate and what each part of the frame costs. Defaults to the dummy video
+// driver unless SDL_VIDEODRIVER says otherwise (e.g. offscreen), so it runs
+// on machines without a display or GPU. The game comes from `replay_path`
+// when given, or a built-in script. Returns the process exit status.
+int run_render_bench(uint32_t frames, const char *replay_path);
+
+#endif
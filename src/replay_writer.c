@@ -0,0 +1,157 @@
+#include "replay_writer.h"
+
+static ReplayChunk *current_chunk(ReplayWriter *writer) {
+  return &writer->chunks[SDL_AtomicGet(&writer->head) & (REPLAY_CHUNK_COUNT - 1)];
+}
+
+static void hand_over(ReplayWriter *writer) {
+  int head = SDL_AtomicGet(&writer->head);
+
+  // The writer is a whole ring behind. Replays can't skip records, so this
+  // is the one place recording waits, and at a few bytes per input it takes
+  // a stalled disk to get here.
+  while (head + 1 - SDL_AtomicGet(&writer->tail) >= REPLAY_CHUNK_COUNT)
+    SDL_Delay(1);
+
+  writer->chunks[(head + 1) & (REPLAY_CHUNK_COUNT - 1)].size = 0;
+  SDL_AtomicSet(&writer->head, head + 1);
+  SDL_SemPost(writer->ready);
+}
+
+// Copies an encoded record into the current chunk, starting a new chunk
+// first if it doesn't fit.
+static void append(ReplayWriter *writer, const uint8_t *bytes, size_t size) {
+  ReplayChunk *chunk = current_chunk(writer);
+
+  if (chunk->size + size > REPLAY_CHUNK_SIZE) {
+    hand_over(writer);
+    chunk = current_chunk(writer);
+  }
+
+  SDL_memcpy(&chunk->bytes[chunk->size], bytes, size);
+  chunk->size += (uint32_t)size;
+  writer->offset += size;
+}
+
+// Keyframes are rare, a few per minute of play, so growing the index as it
+// goes costs nothing worth avoiding. Without room, the keyframe is left out
+// and seeking just starts further back.
+static void add_keyframe(ReplayWriter *writer, uint64_t tick, const GameState *state) {
+  if (writer->keyframe_count == writer->keyframe_capacity) {
+    uint32_t capacity = writer->keyframe_capacity ? writer->keyframe_capacity * 2 : 64;
+    ReplayKeyframe *keyframes =
+        (ReplayKeyframe *)SDL_realloc(writer->keyframes, sizeof(ReplayKeyframe) * capacity);
+    if (!keyframes)
+      return;
+
+    writer->keyframes = keyframes;
+    writer->keyframe_capacity = capacity;
+  }
+
+  uint8_t bytes[REPLAY_RECORD_MAX];
+  size_t size = replay_encode_keyframe(&writer->last_tick, tick, state, bytes);
+
+  // Index the record where it will land, which is in the next chunk if it
+  // doesn't fit this one
+  if (current_chunk(writer)->size + size > REPLAY_CHUNK_SIZE)
+    hand_over(writer);
+
+  writer->keyframes[writer->keyframe_count].offset = writer->offset;
+  writer->keyframes[writer->keyframe_count].tick = tick;
+  writer->keyframe_count++;
+
+  append(writer, bytes, size);
+}
+
+static int writer_thread(void *data) {
+  ReplayWriter *writer = (ReplayWriter *)data;
+
+  while (true) {
+    SDL_SemWait(writer->ready);
+
+    // Read before head, see replay_writer_close
+    bool stopping = !SDL_AtomicGet(&writer->running);
+    int head = SDL_AtomicGet(&writer->head);
+    int tail = SDL_AtomicGet(&writer->tail);
+
+    for (; tail != head; tail++) {
+      const ReplayChunk *chunk = &writer->chunks[tail & (REPLAY_CHUNK_COUNT - 1)];
+      if (fwrite(chunk->bytes, 1, chunk->size, writer->file) != chunk->size)
+        writer->failed = true;
+      SDL_AtomicSet(&writer->tail, tail + 1);
+    }
+
+    if (stopping)
+      return 0;
+  }
+}
+
+static void release(ReplayWriter *writer) {
+  if (writer->ready)
+    SDL_DestroySemaphore(writer->ready);
+  if (writer->file)
+    fclose(writer->file);
+  SDL_free(writer->chunks);
+  SDL_free(writer->keyframes);
+}
+
+bool replay_writer_open(ReplayWriter *writer, const char *path, const ReplayHeader *header) {
+  SDL_memset(writer, 0, sizeof(ReplayWriter));
+
+  writer->chunks = (ReplayChunk *)SDL_calloc(REPLAY_CHUNK_COUNT, sizeof(ReplayChunk));
+  writer->file = fopen(path, "wb");
+  writer->ready = SDL_CreateSemaphore(0);
+  if (!writer->chunks || !writer->file || !writer->ready) {
+    release(writer);
+    return false;
+  }
+
+  writer->keyframe_interval = header->keyframe_interval;
+  writer->next_keyframe = header->keyframe_interval;
+
+  uint8_t bytes[REPLAY_RECORD_MAX];
+  append(writer, bytes, replay_encode_header(header, bytes));
+
+  SDL_AtomicSet(&writer->running, 1);
+  writer->thread = SDL_CreateThread(writer_thread, "replay writer", writer);
+  if (!writer->thread) {
+    release(writer);
+    return false;
+  }
+
+  return true;
+}
+
+void replay_writer_event(ReplayWriter *writer, uint64_t tick, enum GameInput input,
+                         const GameState *state) {
+  uint8_t bytes[REPLAY_RECORD_MAX];
+  append(writer, bytes, replay_encode_event(&writer->last_tick, tick, input, bytes));
+
+  if (writer->keyframe_interval && state->pieces >= writer->next_keyframe) {
+    add_keyframe(writer, tick, state);
+    writer->next_keyframe = (state->pieces / writer->keyframe_interval + 1) * writer->keyframe_interval;
+  }
+}
+
+bool replay_writer_close(ReplayWriter *writer, uint64_t tick, const ReplayTrailer *trailer) {
+  uint8_t bytes[REPLAY_RECORD_MAX];
+  append(writer, bytes, replay_encode_end(&writer->last_tick, tick, trailer, bytes));
+
+  for (uint32_t i = 0; i < writer->keyframe_count; i++)
+    append(writer, bytes,
+           replay_encode_index_entry(writer->keyframes[i].offset, writer->keyframes[i].tick, bytes));
+  append(writer, bytes,
+         replay_encode_index_footer(writer->keyframe_count, writer->keyframe_interval, bytes));
+
+  // Hand over the last, partly filled chunk before saying stop, so the
+  // thread can't see the stop without also seeing that chunk
+  hand_over(writer);
+  SDL_AtomicSet(&writer->running, 0);
+  SDL_SemPost(writer->ready);
+  SDL_WaitThread(writer->thread, NULL);
+
+  bool written = !writer->failed && fflush(writer->file) == 0;
+  release(writer);
+
+  return written;
+}
@@ -0,0 +1,63 @@
+#ifndef BRICKGAME_REPLAY_WRITER_H
+#define BRICKGAME_REPLAY_WRITER_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "core/replay.h"
+
+#define REPLAY_CHUNK_SIZE 4096
+// Must be a power of two.
+#define REPLAY_CHUNK_COUNT 64
+
+typedef struct ReplayChunk {
+  uint8_t bytes[REPLAY_CHUNK_SIZE];
+  uint32_t size;
+} ReplayChunk;
+
+typedef struct ReplayKeyframe {
+  uint64_t offset;
+  uint64_t tick;
+} ReplayKeyframe;
+
+// Records a replay without ever touching the file on the recording thread:
+// records are encoded into fixed chunks, full chunks are handed to a writer
+// thread through a single producer, single consumer ring, and that thread
+// does the I/O. Keyframe offsets are collected as they are written and go
+// into the index when the replay is closed.
+typedef struct ReplayWriter {
+  FILE *file;
+  ReplayChunk *chunks;
+  SDL_atomic_t head; // chunks handed over, recording thread only writes it
+  SDL_atomic_t tail; // chunks written, writer thread only writes it
+  SDL_atomic_t running;
+  SDL_sem *ready;
+  SDL_Thread *thread;
+
+  uint64_t last_tick;
+  uint64_t offset; // bytes recorded so far
+  bool failed;     // a write failed, writer thread only
+
+  uint32_t keyframe_interval;
+  uint32_t next_keyframe; // locked pieces at which the next keyframe is due
+  ReplayKeyframe *keyframes;
+  uint32_t keyframe_count;
+  uint32_t keyframe_capacity;
+} ReplayWriter;
+
+bool replay_writer_open(ReplayWriter *writer, const char *path, const ReplayHeader *header);
+
+// Records a step, given the game as it was after it. Adds a keyframe when
+// the step locked the piece one is due at. Called from the recording thread
+// only.
+void replay_writer_event(ReplayWriter *writer, uint64_t tick, enum GameInput input,
+                         const GameState *state);
+
+// Ends the replay with the trailer and the keyframe index, waits for
+// everything to reach the disk and closes the file. Returns false if any
+// write failed.
+bool replay_writer_close(ReplayWriter *writer, uint64_t tick, const ReplayTrailer *trailer);
+
+#endif
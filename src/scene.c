@@ -0,0 +1,110 @@
+#include "scene.h"
+
+#include <SDL2/SDL_ttf.h>
+#include <stdio.h>
+
+#include "profiler.h"
+
+const SDL_Color TEXT_COLOR = {0xF8, 0xF9, 0xFA, 255};
+const SDL_Color BG_COLOR = {0x21, 0x25, 0x29, 255};
+const SDL_Color BOARD_COLOR = {0x49, 0x50, 0x57, 255};
+
+bool scene_init(Scene *scene, SDL_Renderer *renderer, const char *font_path) {
+  SDL_memset(scene, 0, sizeof(Scene));
+  scene->renderer = renderer;
+  scene->tile_rect.w = 48;
+  scene->tile_rect.h = 48;
+  board_layer_init(&scene->board_layer);
+
+  TTF_Font *font = TTF_OpenFont(font_path, 32);
+  if (!font)
+    return false;
+
+  bool atlas_built = glyph_atlas_init(&scene->atlas, renderer, font);
+  TTF_CloseFont(font);
+  if (!atlas_built)
+    return false;
+
+  scene->tiles = tile_batch_create();
+  if (!scene->tiles) {
+    glyph_atlas_destroy(&scene->atlas);
+    SDL_OutOfMemory();
+    return false;
+  }
+
+  return true;
+}
+
+void scene_destroy(Scene *scene) {
+  glyph_atlas_destroy(&scene->atlas);
+  tile_batch_destroy(scene->tiles);
+  board_layer_destroy(&scene->board_layer);
+}
+
+void scene_layout(Scene *scene, int width, int height) {
+  scene->width = width;
+  scene->height = height;
+
+  scene->board_rect.w = scene->tile_rect.w * 8;
+  scene->board_rect.h = scene->tile_rect.h * 16;
+#ifdef __APPLE__
+  scene->board_rect.x = width - scene->board_rect.w / 2;
+  scene->board_rect.y = height - scene->board_rect.h / 2;
+#else
+  scene->board_rect.x = width / 2 - scene->board_rect.w / 2;
+  scene->board_rect.y = height / 2 - scene->board_rect.h / 2;
+#endif
+}
+
+void scene_draw_board(Scene *scene, const GameState *game) {
+  SDL_Renderer *renderer = scene->renderer;
+
+  // Background
+  SDL_SetRenderDrawColor(renderer, BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, 255);
+  SDL_RenderClear(renderer);
+  PROFILE_COLOR_CHANGES(1);
+  PROFILE_DRAW_CALLS(1);
+
+  // Board BG
+  if (board_layer_update(&scene->board_layer, renderer, scene->tiles, game, scene->tile_rect,
+                         BOARD_COLOR)) {
+    SDL_RenderCopy(renderer, scene->board_layer.texture, NULL, &scene->board_rect);
+    PROFILE_DRAW_CALLS(1);
+    tile_batch_begin(scene->tiles, scene->board_rect, scene->tile_rect, NULL);
+  } else {
+    tile_batch_begin(scene->tiles, scene->board_rect, scene->tile_rect, &BOARD_COLOR);
+
+    // Board FG
+    tile_batch_add_board(scene->tiles, game);
+  }
+}
+
+void scene_draw_pieces(Scene *scene, const GameState *game, float piece_x, float piece_y) {
+  // Falling piece
+  tile_batch_add_piece(scene->tiles, piece_x, piece_y, game->falling_piece, 255);
+
+  // Ghost
+  tile_batch_add_piece(scene->tiles, piece_x, (float)game->ghost_y, game->falling_piece, 40);
+
+  tile_batch_flush(scene->tiles, scene->renderer);
+}
+
+void scene_draw_text(Scene *scene, const GameState *game) {
+  SDL_Renderer *renderer = scene->renderer;
+
+  char score_text[25];
+  if (game->score <= 9999999999999999)
+    sprintf(&score_text[0], "Score: %lu", game->score);
+
+  render_text(renderer, &scene->atlas, 5, 5, score_text, TEXT_COLOR);
+
+  if (game->paused || game->game_over) {
+    SDL_Rect screen_rect = {0, 0, scene->width, scene->height};
+    SDL_SetRenderDrawColor(renderer, BG_COLOR.r, BG_COLOR.g, BG_COLOR.b, 255);
+    SDL_RenderFillRect(renderer, &screen_rect);
+    PROFILE_COLOR_CHANGES(1);
+    PROFILE_DRAW_CALLS(1);
+    render_text_centered(renderer, &scene->atlas, scene->width / 2, scene->height / 2,
+                         game->paused ? "paused" : "game over", TEXT_COLOR);
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef BRICKGAME_SCENE_H
+#define BRICKGAME_SCENE_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+
+#include "core/game.h"
+#include "render.h"
+#include "text.h"
+
+extern const SDL_Color TEXT_COLOR;
+extern const SDL_Color BG_COLOR;
+extern const SDL_Color BOARD_COLOR;
+
+// Everything a frame is drawn with. The game loop and the render benchmark
+// draw through the same functions, so the benchmark measures the real path.
+typedef struct Scene {
+  SDL_Renderer *renderer;
+  GlyphAtlas atlas;
+  TileBatch *tiles;
+  BoardLayer board_layer;
+  SDL_Rect tile_rect;
+  SDL_Rect board_rect;
+  int width;
+  int height;
+} Scene;
+
+// Needs TTF_Init. Returns false with the SDL error set on failure.
+bool scene_init(Scene *scene, SDL_Renderer *renderer, const char *font_path);
+void scene_destroy(Scene *scene);
+
+// Centers the board in a window of the given size.
+void scene_layout(Scene *scene, int width, int height);
+
+// The background and the locked stack.
+void scene_draw_board(Scene *scene, const GameState *game);
+
+// The falling piece at a possibly fractional position, and its ghost.
+void scene_draw_pieces(Scene *scene, const GameState *game, float piece_x, float piece_y);
+
+// The score, and the pause or game over screen.
+void scene_draw_text(Scene *scene, const GameState *game);
+
+#endif
@@ -0,0 +1,316 @@
+#include "simulation.h"
+
+#include "core/trace.h"
+
+#define SNAPSHOT_FRESH 4
+
+static bool input_queue_push(InputQueue *queue, QueuedInput input) {
+  int head = SDL_AtomicGet(&queue->head);
+
+  if (head - SDL_AtomicGet(&queue->tail) == INPUT_QUEUE_SIZE)
+    return false;
+
+  queue->inputs[head & (INPUT_QUEUE_SIZE - 1)] = input;
+  SDL_AtomicSet(&queue->head, head + 1);
+
+  return true;
+}
+
+static bool input_queue_pop(InputQueue *queue, QueuedInput *input) {
+  int tail = SDL_AtomicGet(&queue->tail);
+
+  if (tail == SDL_AtomicGet(&queue->head))
+    return false;
+
+  *input = queue->inputs[tail & (INPUT_QUEUE_SIZE - 1)];
+  SDL_AtomicSet(&queue->tail, tail + 1);
+
+  return true;
+}
+
+static bool timing_queue_push(TimingQueue *queue, InputTiming timing) {
+  int head = SDL_AtomicGet(&queue->head);
+
+  if (head - SDL_AtomicGet(&queue->tail) == TIMING_QUEUE_SIZE)
+    return false;
+
+  queue->timings[head & (TIMING_QUEUE_SIZE - 1)] = timing;
+  SDL_AtomicSet(&queue->head, head + 1);
+
+  return true;
+}
+
+static bool timing_queue_pop(TimingQueue *queue, InputTiming *timing) {
+  int tail = SDL_AtomicGet(&queue->tail);
+
+  if (tail == SDL_AtomicGet(&queue->head))
+    return false;
+
+  *timing = queue->timings[tail & (TIMING_QUEUE_SIZE - 1)];
+  SDL_AtomicSet(&queue->tail, tail + 1);
+
+  return true;
+}
+
+static void publish(Simulation *simulation) {
+  TRACE_SCOPE("publish");
+  Snapshot *snapshot = &simulation->snapshots[simulation->back];
+
+  snapshot->state = simulation->game;
+  snapshot->sequence = ++simulation->sequence;
+  snapshot->tick = simulation->tick;
+  snapshot->inputs_applied = SDL_AtomicGet(&simulation->inputs.tail);
+  snapshot->input_steps = simulation->input_steps;
+  snapshot->published_at = SDL_GetPerformanceCounter();
+
+  simulation->back = SDL_AtomicSet(&simulation->middle, simulation->back | SNAPSHOT_FRESH) & 3;
+}
+
+static bool apply(Simulation *simulation, enum GameInput input) {
+  TRACE_SCOPE("step");
+
+  bool changed = step(&simulation->game, input);
+
+  // Only gravity is eased in, so the renderer has to know about the rest
+  if (changed && input != INPUT_GRAVITY)
+    simulation->input_steps++;
+
+  if (simulation->recorder)
+    replay_writer_event(simulation->recorder, simulation->tick, input, &simulation->game);
+
+  return changed;
+}
+
+// Reads the next event of the replay being played back, or stops playing
+// at its end.
+static void playback_read(Simulation *simulation) {
+  if (replay_next(&simulation->playback, &simulation->next_event_tick,
+                  &simulation->next_event) != REPLAY_RECORD_EVENT)
+    simulation->playing = false;
+}
+
+// Applies every replay event up to the current tick.
+static bool playback_apply(Simulation *simulation) {
+  bool changed = false;
+
+  while (simulation->playing && simulation->next_event_tick <= simulation->tick) {
+    changed |= apply(simulation, simulation->next_event);
+    playback_read(simulation);
+  }
+
+  return changed;
+}
+
+// Advances the game by one fixed tick. Returns true if anything changed.
+static bool tick(Simulation *simulation) {
+  TRACE_SCOPE("tick");
+
+  simulation->tick++;
+
+  // Gravity is in the replay like any other input
+  if (simulation->replaying)
+    return playback_apply(simulation);
+
+  if (simulation->game.paused || simulation->game.game_over)
+    return false;
+
+  simulation->gravity_elapsed_us += 1000000 / simulation->tick_rate;
+
+  uint64_t interval_us = (uint64_t)gravity_interval(&simulation->game) * 1000;
+  if (simulation->gravity_elapsed_us < interval_us)
+    return false;
+
+  simulation->gravity_elapsed_us -= interval_us;
+  return apply(simulation, INPUT_GRAVITY);
+}
+
+static int simulation_thread(void *data) {
+  Simulation *simulation = (Simulation *)data;
+  TRACE_THREAD_NAME("simulation");
+
+  uint64_t frequency = SDL_GetPerformanceFrequency();
+  uint64_t tick_length = frequency / simulation->tick_rate;
+  uint64_t max_accumulated = frequency * SIMULATION_MAX_CATCH_UP_MS / 1000;
+  uint64_t previous = SDL_GetPerformanceCounter();
+  uint64_t accumulated = 0;
+
+  if (playback_apply(simulation))
+    publish(simulation);
+
+  while (SDL_AtomicGet(&simulation->running)) {
+    bool changed = false;
+    QueuedInput input;
+
+    // Skip straight to the next event, publishing each one so there is
+    // still something to watch
+    if (simulation->playing && simulation->playback_fast) {
+      while (input_queue_pop(&simulation->inputs, &input))
+        ;
+      simulation->tick = simulation->next_event_tick;
+      playback_apply(simulation);
+      publish(simulation);
+      continue;
+    }
+
+    // Inputs are applied as soon as they arrive rather than on the next
+    // tick boundary, so the tick rate doesn't add to input latency. Any
+    // input gets published, even one that changed nothing, so
+    // simulation_sync can tell it was seen.
+    while (input_queue_pop(&simulation->inputs, &input)) {
+      changed = true;
+
+      // The player only watches a replay
+      if (simulation->replaying)
+        continue;
+
+      bool applied = apply(simulation, input.input);
+
+      // Inputs that changed nothing have nothing to show, so they have no
+      // latency to measure. A full queue just drops the sample.
+      if (applied && simulation->measure_latency) {
+        InputTiming timing;
+        timing.id = SDL_AtomicGet(&simulation->inputs.tail) - 1;
+        timing.input = input.input;
+        timing.sent_at = input.sent_at;
+        timing.applied_at = SDL_GetPerformanceCounter();
+        timing_queue_push(&simulation->timings, timing);
+      }
+    }
+
+    uint64_t now = SDL_GetPerformanceCounter();
+    accumulated += now - previous;
+    previous = now;
+    if (accumulated > max_accumulated)
+      accumulated = max_accumulated;
+
+    while (accumulated >= tick_length) {
+      changed |= tick(simulation);
+      accumulated -= tick_length;
+    }
+
+    if (changed)
+      publish(simulation);
+
+    // Round up, a zero timeout would spin until the tick is due
+    uint32_t timeout = (uint32_t)(((tick_length - accumulated) * 1000 + frequency - 1) / frequency);
+    SDL_SemWaitTimeout(simulation->wake, timeout);
+  }
+
+  return 0;
+}
+
+bool simulation_start(Simulation *simulation, const SimulationSettings *settings) {
+  uint64_t seed = settings->seed;
+  uint32_t tick_rate = settings->tick_rate;
+
+  simulation->replaying = settings->playback != NULL;
+  simulation->playing = simulation->replaying;
+  simulation->playback_fast = settings->playback_fast;
+  if (simulation->replaying) {
+    if (!replay_reader_init(&simulation->playback, settings->playback, settings->playback_size)) {
+      SDL_SetError("Not a replay this version can play");
+      return false;
+    }
+    seed = simulation->playback.header.seed;
+    tick_rate = simulation->playback.header.tick_rate;
+    playback_read(simulation);
+  }
+
+  game_init(&simulation->game, seed);
+
+  simulation->measure_latency = settings->measure_latency;
+  simulation->recorder = settings->recorder;
+  simulation->tick_rate = tick_rate;
+  simulation->tick = 0;
+  simulation->gravity_elapsed_us = 0;
+  simulation->input_steps = 0;
+
+  SDL_AtomicSet(&simulation->inputs.head, 0);
+  SDL_AtomicSet(&simulation->inputs.tail, 0);
+  SDL_AtomicSet(&simulation->timings.head, 0);
+  SDL_AtomicSet(&simulation->timings.tail, 0);
+
+  simulation->sequence = 0;
+  simulation->back = 0;
+  simulation->front = 1;
+  SDL_AtomicSet(&simulation->middle, 2);
+
+  // Start with something to show
+  simulation->snapshots[simulation->front].state = simulation->game;
+  simulation->snapshots[simulation->front].sequence = 0;
+  simulation->snapshots[simulation->front].tick = 0;
+  simulation->snapshots[simulation->front].inputs_applied = 0;
+  simulation->snapshots[simulation->front].input_steps = 0;
+  simulation->snapshots[simulation->front].published_at = SDL_GetPerformanceCounter();
+
+  simulation->wake = SDL_CreateSemaphore(0);
+  if (!simulation->wake)
+    return false;
+
+  SDL_AtomicSet(&simulation->running, 1);
+  simulation->thread = SDL_CreateThread(simulation_thread, "simulation", simulation);
+  if (!simulation->thread) {
+    SDL_DestroySemaphore(simulation->wake);
+    return false;
+  }
+
+  return true;
+}
+
+void simulation_stop(Simulation *simulation) {
+  SDL_AtomicSet(&simulation->running, 0);
+  SDL_SemPost(simulation->wake);
+  SDL_WaitThread(simulation->thread, NULL);
+  SDL_DestroySemaphore(simulation->wake);
+}
+
+bool simulation_send(Simulation *simulation, enum GameInput input, uint64_t sent_at) {
+  QueuedInput queued;
+  queued.input = input;
+  queued.sent_at = sent_at;
+
+  if (!input_queue_push(&simulation->inputs, queued))
+    return false;
+
+  SDL_SemPost(simulation->wake);
+
+  return true;
+}
+
+bool simulation_next_timing(Simulation *simulation, InputTiming *timing) {
+  return timing_queue_pop(&simulation->timings, timing);
+}
+
+const Snapshot *simulation_latest(Simulation *simulation) {
+  if (SDL_AtomicGet(&simulation->middle) & SNAPSHOT_FRESH)
+    simulation->front = SDL_AtomicSet(&simulation->middle, simulation->front) & 3;
+
+  return &simulation->snapshots[simulation->front];
+}
+
+const Snapshot *simulation_sync(Simulation *simulation, uint32_t timeout_us) {
+  int sent = SDL_AtomicGet(&simulation->inputs.head);
+  const Snapshot *snapshot = simulation_latest(simulation);
+
+  if (snapshot->inputs_applied == sent)
+    return snapshot;
+
+  uint64_t frequency = SDL_GetPerformanceFrequency();
+  uint64_t deadline = SDL_GetPerformanceCounter() + frequency * timeout_us / 1000000;
+
+  // Applying a few inputs takes microseconds once the thread is awake, so
+  // yield rather than sleep
+  while (snapshot->inputs_applied != sent && SDL_GetPerformanceCounter() < deadline) {
+    SDL_Delay(0);
+    snapshot = simulation_latest(simulation);
+  }
+
+  return snapshot;
+}
+
+float simulation_alpha(const Simulation *simulation, const Snapshot *snapshot) {
+  uint64_t elapsed = SDL_GetPerformanceCounter() - snapshot->published_at;
+  float alpha = (float)elapsed * simulation->tick_rate / (float)SDL_GetPerformanceFrequency();
+
+  return alpha < 1 ? alpha : 1;
+}
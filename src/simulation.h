@@ -0,0 +1,142 @@
+#ifndef BRICKGAME_SIMULATION_H
+#define BRICKGAME_SIMULATION_H
+
+#include <SDL2/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/game.h"
+#include "core/replay.h"
+#include "replay_writer.h"
+
+// Must be a power of two.
+#define INPUT_QUEUE_SIZE 64
+
+typedef struct QueuedInput {
+  enum GameInput input;
+  uint64_t sent_at; // performance counter, when the key was pressed
+} QueuedInput;
+
+// Single producer (the main thread), single consumer (the simulation thread).
+typedef struct InputQueue {
+  QueuedInput inputs[INPUT_QUEUE_SIZE];
+  SDL_atomic_t head __attribute__((aligned(GAME_CACHE_LINE_SIZE)));
+  SDL_atomic_t tail __attribute__((aligned(GAME_CACHE_LINE_SIZE)));
+} InputQueue;
+
+// When an input was sent and when the simulation applied it, reported back
+// to the main thread while measuring latency. `id` is the input's position
+// in the input queue, comparable with Snapshot::inputs_applied.
+typedef struct InputTiming {
+  int id;
+  enum GameInput input;
+  uint64_t sent_at;
+  uint64_t applied_at;
+} InputTiming;
+
+// Must be a power of two.
+#define TIMING_QUEUE_SIZE 256
+
+// Single producer (the simulation thread), single consumer (the main thread).
+typedef struct TimingQueue {
+  InputTiming timings[TIMING_QUEUE_SIZE];
+  SDL_atomic_t head __attribute__((aligned(GAME_CACHE_LINE_SIZE)));
+  SDL_atomic_t tail __attribute__((aligned(GAME_CACHE_LINE_SIZE)));
+} TimingQueue;
+
+// A copy of the game as it was after some step, never touched again once
+// published.
+typedef struct Snapshot {
+  GameState state;
+  uint64_t sequence;
+  uint64_t tick;         // simulation tick the state belongs to
+  int inputs_applied;    // queue position the state has caught up with
+  uint64_t input_steps;  // steps other than gravity that changed the game
+  uint64_t published_at; // performance counter
+} Snapshot;
+
+// Upper bound on how far the simulation catches up after a stall, so a long
+// hitch doesn't turn into a burst of gravity steps.
+#define SIMULATION_MAX_CATCH_UP_MS 250
+
+typedef struct SimulationSettings {
+  uint64_t seed;
+  uint32_t tick_rate;
+  bool measure_latency;
+
+  // Every step the simulation takes goes here, when set
+  ReplayWriter *recorder;
+
+  // When set, the game is driven by this replay instead of by sent inputs
+  // and its own gravity; seed and tick_rate come from the replay.
+  // `playback_fast` ignores the clock and plays it as fast as possible.
+  const uint8_t *playback;
+  size_t playback_size;
+  bool playback_fast;
+} SimulationSettings;
+
+// The game is owned by one simulation thread, which applies queued inputs
+// and advances in fixed ticks of 1/tick_rate seconds, independent of the
+// display's refresh rate. Gravity is counted in ticks, so it behaves the
+// same at any frame rate. Snapshots are published through a triple buffer:
+// the thread always writes a slot the main thread can't be reading, and the
+// main thread always picks up the newest complete one.
+typedef struct Simulation {
+  GameState game;
+  InputQueue inputs;
+
+  bool measure_latency;
+  TimingQueue timings;
+
+  uint32_t tick_rate;
+  uint64_t tick;
+  uint64_t gravity_elapsed_us;
+  uint64_t input_steps;
+
+  ReplayWriter *recorder;
+
+  bool replaying; // driven by `playback`, and frozen once it runs out
+  bool playing;   // `playback` has events left
+  bool playback_fast;
+  ReplayReader playback;
+  uint64_t next_event_tick; // the event read ahead from `playback`
+  enum GameInput next_event;
+
+  Snapshot snapshots[3];
+  SDL_atomic_t middle; // slot handed between the threads, plus SNAPSHOT_FRESH
+  int back;            // slot being written, simulation thread only
+  int front;           // slot being read, main thread only
+  uint64_t sequence;
+
+  SDL_atomic_t running;
+  SDL_sem *wake;
+  SDL_Thread *thread;
+} Simulation;
+
+// Returns false if the thread couldn't be started or the replay to play
+// back can't be read.
+bool simulation_start(Simulation *simulation, const SimulationSettings *settings);
+void simulation_stop(Simulation *simulation);
+
+// Queues an input for the simulation thread. `sent_at` is when it happened,
+// on the performance counter. Returns false if the queue is full.
+bool simulation_send(Simulation *simulation, enum GameInput input, uint64_t sent_at);
+
+// Pops the next report of an applied input that changed the game, when
+// started with measure_latency set. Returns false if there is none.
+bool simulation_next_timing(Simulation *simulation, InputTiming *timing);
+
+// Returns the newest published snapshot. It stays valid and unchanged until
+// the next call.
+const Snapshot *simulation_latest(Simulation *simulation);
+
+// Like simulation_latest, but first gives the simulation thread up to
+// `timeout_us` to apply everything sent so far, so a frame built right after
+// polling input already shows it.
+const Snapshot *simulation_sync(Simulation *simulation, uint32_t timeout_us);
+
+// How far the renderer is between `snapshot` and the tick after it, from 0 to
+// 1, for interpolating motion.
+float simulation_alpha(const Simulation *simulation, const Snapshot *snapshot);
+
+#endif
@@ -0,0 +1,244 @@
+#include "text.h"
+
+#include "core/trace.h"
+#include "profiler.h"
+
+#define ATLAS_MAX_WIDTH 512
+#define GLYPH_BATCH 64
+
+static int glyph_index(char c) {
+  if (c < GLYPH_FIRST || c >= GLYPH_FIRST + GLYPH_COUNT)
+    return '?' - GLYPH_FIRST;
+  return c - GLYPH_FIRST;
+}
+
+bool glyph_atlas_init(GlyphAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font) {
+  SDL_Color white = {255, 255, 255, 255};
+  SDL_Surface *glyph_surfaces[GLYPH_COUNT];
+
+  SDL_memset(atlas, 0, sizeof(GlyphAtlas));
+  atlas->line_height = TTF_FontHeight(font);
+
+  // Lay the glyphs out in rows
+  int pen_x = 0;
+  int pen_y = 0;
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    Uint16 ch = GLYPH_FIRST + i;
+    int minx, maxx, miny, maxy;
+
+    glyph_surfaces[i] = TTF_RenderGlyph_Blended(font, ch, white);
+    if (!glyph_surfaces[i] || TTF_GlyphMetrics(font, ch, &minx, &maxx, &miny, &maxy,
+                                               &atlas->advances[i]) < 0) {
+      for (int j = 0; j <= i; j++)
+        SDL_FreeSurface(glyph_surfaces[j]);
+      return false;
+    }
+
+    if (pen_x + glyph_surfaces[i]->w > ATLAS_MAX_WIDTH) {
+      pen_x = 0;
+      pen_y += atlas->line_height;
+    }
+
+    atlas->glyphs[i].x = pen_x;
+    atlas->glyphs[i].y = pen_y;
+    atlas->glyphs[i].w = glyph_surfaces[i]->w;
+    atlas->glyphs[i].h = glyph_surfaces[i]->h;
+    atlas->offsets[i] = minx < 0 ? minx : 0;
+
+    pen_x += glyph_surfaces[i]->w;
+    if (pen_x > atlas->width)
+      atlas->width = pen_x;
+  }
+  atlas->height = pen_y + atlas->line_height;
+
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    for (int j = 0; j < GLYPH_COUNT; j++) {
+      atlas->kerning[i][j] =
+          (int8_t)TTF_GetFontKerningSizeGlyphs(font, GLYPH_FIRST + i, GLYPH_FIRST + j);
+    }
+  }
+
+  SDL_Surface *surface =
+      SDL_CreateRGBSurfaceWithFormat(0, atlas->width, atlas->height, 32, SDL_PIXELFORMAT_ARGB8888);
+  if (surface) {
+    SDL_FillRect(surface, NULL, SDL_MapRGBA(surface->format, 255, 255, 255, 0));
+
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+      // Copy the coverage as is instead of blending it onto the background
+      SDL_Rect dest = atlas->glyphs[i];
+      SDL_SetSurfaceBlendMode(glyph_surfaces[i], SDL_BLENDMODE_NONE);
+      SDL_BlitSurface(glyph_surfaces[i], NULL, surface, &dest);
+    }
+
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+  }
+
+  for (int i = 0; i < GLYPH_COUNT; i++)
+    SDL_FreeSurface(glyph_surfaces[i]);
+
+  if (!atlas->texture)
+    return false;
+
+  SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+  atlas->use_geometry = true;
+
+  return true;
+}
+
+void glyph_atlas_destroy(GlyphAtlas *atlas) {
+  if (atlas->texture)
+    SDL_DestroyTexture(atlas->texture);
+  atlas->texture = NULL;
+}
+
+int text_width(const GlyphAtlas *atlas, const char *text) {
+  int width = 0;
+  int previous = -1;
+
+  for (const char *c = text; *c; c++) {
+    int glyph = glyph_index(*c);
+
+    if (previous >= 0)
+      width += atlas->kerning[previous][glyph];
+    width += atlas->advances[glyph];
+    previous = glyph;
+  }
+
+  return width;
+}
+
+// Advances the pen over one character and returns the glyph to draw for it
+// and where to draw it.
+static int layout_glyph(const GlyphAtlas *atlas, char c, int *pen_x, int *previous, int32_t y,
+                        SDL_Rect *dest) {
+  int glyph = glyph_index(c);
+
+  if (*previous >= 0)
+    *pen_x += atlas->kerning[*previous][glyph];
+  *previous = glyph;
+
+  dest->x = *pen_x + atlas->offsets[glyph];
+  dest->y = y;
+  dest->w = atlas->glyphs[glyph].w;
+  dest->h = atlas->glyphs[glyph].h;
+
+  *pen_x += atlas->advances[glyph];
+
+  return glyph;
+}
+
+static void render_glyphs_copy(SDL_Renderer *renderer, const GlyphAtlas *atlas, int32_t x,
+                               int32_t y, const char *text, SDL_Color color) {
+  int pen_x = x;
+  int previous = -1;
+
+  SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+  SDL_SetTextureAlphaMod(atlas->texture, color.a);
+  PROFILE_COLOR_CHANGES(2);
+
+  for (const char *c = text; *c; c++) {
+    SDL_Rect dest;
+    int glyph = layout_glyph(atlas, *c, &pen_x, &previous, y, &dest);
+
+    if (*c != ' ') {
+      SDL_RenderCopy(renderer, atlas->texture, &atlas->glyphs[glyph], &dest);
+      PROFILE_DRAW_CALLS(1);
+    }
+  }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+
+static SDL_Vertex glyph_vertex(float x, float y, SDL_Color color, float u, float v) {
+  SDL_Vertex vertex = {{x, y}, color, {u, v}};
+  return vertex;
+}
+
+// Draws the whole string as one batch of quads. Returns false if the
+// renderer can't draw geometry.
+static bool render_glyphs_geometry(SDL_Renderer *renderer, const GlyphAtlas *atlas, int32_t x,
+                                   int32_t y, const char *text, SDL_Color color) {
+  SDL_Vertex vertices[GLYPH_BATCH * 4];
+  int indices[GLYPH_BATCH * 6];
+  int count = 0;
+  int pen_x = x;
+  int previous = -1;
+
+  // The vertex color does the tinting
+  SDL_SetTextureColorMod(atlas->texture, 255, 255, 255);
+  SDL_SetTextureAlphaMod(atlas->texture, 255);
+  PROFILE_COLOR_CHANGES(2);
+
+  for (const char *c = text; *c; c++) {
+    SDL_Rect dest;
+    int glyph = layout_glyph(atlas, *c, &pen_x, &previous, y, &dest);
+    const SDL_Rect *source = &atlas->glyphs[glyph];
+
+    if (*c == ' ')
+      continue;
+
+    float u0 = (float)source->x / atlas->width;
+    float v0 = (float)source->y / atlas->height;
+    float u1 = (float)(source->x + source->w) / atlas->width;
+    float v1 = (float)(source->y + source->h) / atlas->height;
+    float x0 = (float)dest.x;
+    float y0 = (float)dest.y;
+    float x1 = (float)(dest.x + dest.w);
+    float y1 = (float)(dest.y + dest.h);
+
+    SDL_Vertex *quad = &vertices[count * 4];
+    quad[0] = glyph_vertex(x0, y0, color, u0, v0);
+    quad[1] = glyph_vertex(x1, y0, color, u1, v0);
+    quad[2] = glyph_vertex(x1, y1, color, u1, v1);
+    quad[3] = glyph_vertex(x0, y1, color, u0, v1);
+
+    int *quad_indices = &indices[count * 6];
+    quad_indices[0] = count * 4;
+    quad_indices[1] = count * 4 + 1;
+    quad_indices[2] = count * 4 + 2;
+    quad_indices[3] = count * 4;
+    quad_indices[4] = count * 4 + 2;
+    quad_indices[5] = count * 4 + 3;
+
+    if (++count == GLYPH_BATCH) {
+      PROFILE_DRAW_CALLS(1);
+      if (SDL_RenderGeometry(renderer, atlas->texture, vertices, count * 4, indices,
+                             count * 6) < 0)
+        return false;
+      count = 0;
+    }
+  }
+
+  PROFILE_DRAW_CALLS(count != 0);
+  if (count)
+    return SDL_RenderGeometry(renderer, atlas->texture, vertices, count * 4, indices,
+                              count * 6) == 0;
+
+  return true;
+}
+
+#endif
+
+void render_text(SDL_Renderer *renderer, GlyphAtlas *atlas, int32_t x, int32_t y,
+                 const char *text, SDL_Color color) {
+  TRACE_SCOPE("render_text");
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+  if (atlas->use_geometry) {
+    if (render_glyphs_geometry(renderer, atlas, x, y, text, color))
+      return;
+
+    // Only the first string can fail this way, before anything was drawn
+    atlas->use_geometry = false;
+  }
+#endif
+
+  render_glyphs_copy(renderer, atlas, x, y, text, color);
+}
+
+void render_text_centered(SDL_Renderer *renderer, GlyphAtlas *atlas, int32_t x,
+                          int32_t y, const char *text, SDL_Color color) {
+  render_text(renderer, atlas, x - text_width(atlas, text) / 2, y - atlas->line_height / 2,
+              text, color);
+}
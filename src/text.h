@@ -0,0 +1,38 @@
+#ifndef BRICKGAME_TEXT_H
+#define BRICKGAME_TEXT_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GLYPH_FIRST ' '
+#define GLYPH_COUNT ('~' - ' ' + 1)
+
+// Every printable ASCII glyph of a font rasterized once into one texture, so
+// drawing text is just quads sampling from it.
+typedef struct GlyphAtlas {
+  SDL_Texture *texture;
+  int width;
+  int height;
+  int line_height;
+
+  SDL_Rect glyphs[GLYPH_COUNT]; // where each glyph sits in the texture
+  int offsets[GLYPH_COUNT];     // from the pen position to the glyph's left edge
+  int advances[GLYPH_COUNT];
+  int8_t kerning[GLYPH_COUNT][GLYPH_COUNT];
+
+  bool use_geometry; // cleared if the renderer turns out not to support it
+} GlyphAtlas;
+
+bool glyph_atlas_init(GlyphAtlas *atlas, SDL_Renderer *renderer, TTF_Font *font);
+void glyph_atlas_destroy(GlyphAtlas *atlas);
+
+int text_width(const GlyphAtlas *atlas, const char *text);
+
+void render_text(SDL_Renderer *renderer, GlyphAtlas *atlas, int32_t x, int32_t y,
+                 const char *text, SDL_Color color);
+void render_text_centered(SDL_Renderer *renderer, GlyphAtlas *atlas, int32_t x,
+                          int32_t y, const char *text, SDL_Color color);
+
+#endif
@@ -0,0 +1,338 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core/game.h"
+#include "core/replay.h"
+
+// Re-simulates every replay (*.brkr) in a directory and checks that the
+// score, lines and pieces each one claims are what the game really ended
+// with. Build and run with `make verify VERIFY_ARGS=<dir>`.
+//
+// Files are mapped rather than read, and each worker simulates into the one
+// GameState it was given up front, so nothing is allocated per replay. The
+// replays are split evenly between the workers; a worker that runs out
+// steals half of what is left of someone else's share, so a few long
+// replays don't leave the other cores idle.
+
+#define MAX_WORKERS 256
+#define REPLAY_EXTENSION ".brkr"
+
+enum VerifyStatus {
+  VERIFY_OK,
+  VERIFY_MISMATCH,
+  VERIFY_MALFORMED,
+  VERIFY_UNREADABLE,
+};
+
+typedef struct VerifyResult {
+  enum VerifyStatus status;
+  ReplayTrailer claimed;
+  ReplayTrailer actual;
+  size_t bytes;
+} VerifyResult;
+
+// The replays a worker has left, [begin, end) packed into one word so the
+// owner taking from the front and thieves taking from the back agree
+// through a single compare and swap.
+typedef struct WorkRange {
+  uint64_t range;
+} __attribute__((aligned(GAME_CACHE_LINE_SIZE))) WorkRange;
+
+typedef struct Verifier {
+  const char *directory;
+  char **paths;
+  VerifyResult *results;
+  uint32_t count;
+
+  WorkRange ranges[MAX_WORKERS];
+  GameState *states; // one per worker
+  int workers;
+} Verifier;
+
+typedef struct Worker {
+  Verifier *verifier;
+  int id;
+  pthread_t thread;
+} Worker;
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t pack_range(uint32_t begin, uint32_t end) {
+  return (uint64_t)begin << 32 | end;
+}
+
+// Takes the next replay of a worker's own share. Returns false once it's
+// empty.
+static bool take(WorkRange *range, uint32_t *replay) {
+  uint64_t packed = __atomic_load_n(&range->range, __ATOMIC_ACQUIRE);
+
+  while (true) {
+    uint32_t begin = (uint32_t)(packed >> 32);
+    uint32_t end = (uint32_t)packed;
+
+    if (begin >= end)
+      return false;
+
+    if (__atomic_compare_exchange_n(&range->range, &packed, pack_range(begin + 1, end), true,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+      *replay = begin;
+      return true;
+    }
+  }
+}
+
+// Moves the back half of another worker's share (all of it, if just one is
+// left) into `thief`'s own, which is empty. Returns false if there was
+// nothing left anywhere.
+static bool steal(Verifier *verifier, int thief) {
+  for (int i = 1; i < verifier->workers; i++) {
+    WorkRange *victim = &verifier->ranges[(thief + i) % verifier->workers];
+    uint64_t packed = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+
+    while (true) {
+      uint32_t begin = (uint32_t)(packed >> 32);
+      uint32_t end = (uint32_t)packed;
+
+      if (begin >= end)
+        break;
+
+      uint32_t middle = begin + (end - begin) / 2;
+      if (__atomic_compare_exchange_n(&victim->range, &packed, pack_range(begin, middle), true,
+                                      __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&verifier->ranges[thief].range, pack_range(middle, end),
+                         __ATOMIC_RELEASE);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+static void verify_replay(const char *path, GameState *state, VerifyResult *result) {
+  result->status = VERIFY_UNREADABLE;
+
+  int file = open(path, O_RDONLY);
+  if (file < 0)
+    return;
+
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0) {
+    close(file);
+    return;
+  }
+
+  result->bytes = (size_t)info.st_size;
+  void *data = mmap(NULL, result->bytes, PROT_READ, MAP_PRIVATE, file, 0);
+  close(file);
+  if (data == MAP_FAILED)
+    return;
+
+  madvise(data, result->bytes, MADV_SEQUENTIAL);
+
+  if (!replay_simulate((const uint8_t *)data, result->bytes, state, &result->claimed)) {
+    result->status = VERIFY_MALFORMED;
+  } else {
+    result->actual.score = state->score;
+    result->actual.lines = state->lines;
+    result->actual.pieces = state->pieces;
+
+    bool matches = result->claimed.score == result->actual.score &&
+                   result->claimed.lines == result->actual.lines &&
+                   result->claimed.pieces == result->actual.pieces;
+    result->status = matches ? VERIFY_OK : VERIFY_MISMATCH;
+  }
+
+  munmap(data, result->bytes);
+}
+
+static void *worker_thread(void *data) {
+  Worker *worker = (Worker *)data;
+  Verifier *verifier = worker->verifier;
+  GameState *state = &verifier->states[worker->id];
+  uint32_t replay;
+
+  do {
+    while (take(&verifier->ranges[worker->id], &replay))
+      verify_replay(verifier->paths[replay], state, &verifier->results[replay]);
+  } while (steal(verifier, worker->id));
+
+  return NULL;
+}
+
+static bool is_replay(const char *name) {
+  size_t length = strlen(name);
+  size_t extension = strlen(REPLAY_EXTENSION);
+
+  return length > extension && strcmp(name + length - extension, REPLAY_EXTENSION) == 0;
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Collects the paths of every replay in the directory, sorted so reports
+// come out in a stable order.
+static bool find_replays(Verifier *verifier) {
+  DIR *directory = opendir(verifier->directory);
+  if (!directory) {
+    fprintf(stderr, "Error: Couldn't open directory %s\n", verifier->directory);
+    return false;
+  }
+
+  uint32_t capacity = 0;
+  struct dirent *entry;
+  while ((entry = readdir(directory))) {
+    if (!is_replay(entry->d_name))
+      continue;
+
+    if (verifier->count == capacity) {
+      capacity = capacity ? capacity * 2 : 256;
+      char **paths = (char **)realloc(verifier->paths, sizeof(char *) * capacity);
+      if (!paths) {
+        fprintf(stderr, "Error: Couldn't allocate the replay list\n");
+        closedir(directory);
+        return false;
+      }
+      verifier->paths = paths;
+    }
+
+    size_t size = strlen(verifier->directory) + strlen(entry->d_name) + 2;
+    char *path = (char *)malloc(size);
+    if (!path) {
+      fprintf(stderr, "Error: Couldn't allocate the replay list\n");
+      closedir(directory);
+      return false;
+    }
+    snprintf(path, size, "%s/%s", verifier->directory, entry->d_name);
+    verifier->paths[verifier->count++] = path;
+  }
+  closedir(directory);
+
+  if (verifier->count)
+    qsort(verifier->paths, verifier->count, sizeof(char *), compare_paths);
+
+  return true;
+}
+
+static void print_usage(const char *program) {
+  fprintf(stderr, "Usage: %s <directory> [--threads <n>]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+  static Verifier verifier;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = strtol(argv[++i], NULL, 10);
+    } else if (argv[i][0] != '-' && !verifier.directory) {
+      verifier.directory = argv[i];
+    } else {
+      print_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!verifier.directory) {
+    print_usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (threads < 1)
+    threads = 1;
+  if (threads > MAX_WORKERS)
+    threads = MAX_WORKERS;
+
+  if (!find_replays(&verifier))
+    return EXIT_FAILURE;
+  if (!verifier.count) {
+    fprintf(stderr, "Error: No %s files in %s\n", REPLAY_EXTENSION, verifier.directory);
+    return EXIT_FAILURE;
+  }
+
+  // No point in more workers than replays
+  verifier.workers = threads < verifier.count ? (int)threads : (int)verifier.count;
+  verifier.results = (VerifyResult *)calloc(verifier.count, sizeof(VerifyResult));
+  verifier.states = game_alloc(verifier.workers);
+  Worker *workers = (Worker *)calloc(verifier.workers, sizeof(Worker));
+  if (!verifier.results || !verifier.states || !workers) {
+    fprintf(stderr, "Error: Couldn't allocate the verifier\n");
+    return EXIT_FAILURE;
+  }
+
+  for (int i = 0; i < verifier.workers; i++) {
+    uint32_t begin = (uint32_t)((uint64_t)verifier.count * i / verifier.workers);
+    uint32_t end = (uint32_t)((uint64_t)verifier.count * (i + 1) / verifier.workers);
+    verifier.ranges[i].range = pack_range(begin, end);
+  }
+
+  uint64_t start = now_ns();
+
+  for (int i = 0; i < verifier.workers; i++) {
+    workers[i].verifier = &verifier;
+    workers[i].id = i;
+    if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i]) != 0) {
+      fprintf(stderr, "Error: Couldn't start worker %d\n", i);
+      return EXIT_FAILURE;
+    }
+  }
+  for (int i = 0; i < verifier.workers; i++)
+    pthread_join(workers[i].thread, NULL);
+
+  double seconds = (double)(now_ns() - start) / 1e9;
+
+  uint32_t failures = 0;
+  uint64_t bytes = 0;
+  uint64_t pieces = 0;
+  for (uint32_t i = 0; i < verifier.count; i++) {
+    const VerifyResult *result = &verifier.results[i];
+    bytes += result->bytes;
+    pieces += result->actual.pieces;
+
+    switch (result->status) {
+    case VERIFY_OK:
+      continue;
+    case VERIFY_MISMATCH:
+      printf("%s: claims score %llu, %u lines, %u pieces; replays to score %llu, %u lines, "
+             "%u pieces\n",
+             verifier.paths[i], (unsigned long long)result->claimed.score,
+             result->claimed.lines, result->claimed.pieces,
+             (unsigned long long)result->actual.score, result->actual.lines,
+             result->actual.pieces);
+      break;
+    case VERIFY_MALFORMED:
+      printf("%s: not a valid replay\n", verifier.paths[i]);
+      break;
+    case VERIFY_UNREADABLE:
+      printf("%s: couldn't be read\n", verifier.paths[i]);
+      break;
+    }
+    failures++;
+  }
+
+  printf("%u replays, %u failed, on %d threads in %.3f s: %.1f replays/s, %.1f MB/s, "
+         "%.0f pieces/s\n",
+         verifier.count, failures, verifier.workers, seconds, verifier.count / seconds,
+         bytes / seconds / 1e6, pieces / seconds);
+
+  for (uint32_t i = 0; i < verifier.count; i++)
+    free(verifier.paths[i]);
+  free(verifier.paths);
+  free(verifier.results);
+  free(workers);
+  game_free(verifier.states);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}